@@ -25,6 +25,23 @@ atomix supports the following additional options:
     Determines the number of layers as a power of 2. For example the default value of 8 means 256 layers.
 #define ATOMIX_ZALLOC(S)
     Overrides the zalloc function used by atomix with your own. This is calloc but with just 1 argument.
+#define ATOMIX_FREE(P)
+    Overrides the free function used by atomix for temporary memory, which must match ATOMIX_ZALLOC.
+#define ATOMIX_TRACE(M, E)
+    Enables call tracing, invoked with the mixer and a pointer to a struct atomix_event for every public
+    mixer call, including atomixMixerMix from the mixing thread. See "atomix tracing" for more details.
+#define ATOMIX_PROFILE
+    Enables per-sound cost attribution of mixing, queried with atomixSoundProfile. See "atomix profiling".
+#define ATOMIX_CLOCK()
+    Overrides the cycle counter used for profiling and time budgets. Defaults to rdtsc on x86 and clock() elsewhere.
+#define ATOMIX_MONO_TOL
+    Sets how far left and right may differ for ATOMIX_MONO to store stereo data as mono, defaults to 2^-15.
+#define ATOMIX_SHM
+    Enables sound banks in named POSIX shared memory, see "atomix shared memory" for details. Strict C modes
+    need _POSIX_C_SOURCE defined as 200809L before any includes, and older glibc needs linking with -lrt.
+#define ATOMIX_MLOCK
+    Locks sounds, mixers, and banks into memory as they are created and adds atomixThreadRealtime (POSIX only).
+    See "atomix real-time" for details, strict C modes need _POSIX_C_SOURCE as for ATOMIX_SHM.
 
 atomix threads:
     Atomix is built around having one thread occasionally calling atomixMixerMix (usually in a callback)
@@ -42,6 +59,163 @@ atomix fading:
     Fading out will not happen if the sound is close to its end, in which case it will simply play out instead.
     A sound started in a halted state will start fully faded out, resulting in a fade in when it is unhalted.
 
+atomix positional sounds:
+    Sounds given a direction with atomixMixerSetDirection are positional, they are encoded into first-order
+    ambisonics (B-format W, X, Y, Z) with gains computed from their direction, rotated into the orientation
+    of the listener set with atomixMixerListener, and decoded to stereo using two virtual cardioid microphones
+    facing left and right. As every step is linear, the rotation and decoding are folded into one 2x4 matrix
+    once per mix, and each positional sound multiplies its four encoding gains through that matrix once per
+    mix as well. This results in the same output as summing a B-format bus and decoding it, but costs nothing
+    per frame beyond the regular stereo kernels. The pan of a positional sound is ignored, its gain is not.
+    Calling atomixMixerBinaural with the output sample rate switches positional sounds to binaural rendering
+    for headphones instead, using a parametric spherical head model (Brown and Duda) that needs no HRTF data.
+    Each ear gets an interaural time delay and a first-order head shadow filter derived from the incidence
+    angle, with both ears filtered together in SIMD lanes and all parameters smoothed across each mix. This
+    costs a delay line read and filter step per frame, so expect binaural sounds to be about ten times as costly.
+    Positional sounds given a velocity relative to the listener with atomixMixerSetVelocity are pitched by the
+    Doppler effect, assuming distances in meters. Playback rates are computed once per mix for active layers
+    only, from the pitch alone unless moving, with the Doppler shift of moving layers in an SSE pass over 4 of
+    them at a time, and moving sounds read their data at a fractional cursor with linear interpolation, with the rate ramping smoothly across each mix. The shared cursor only ever advances in
+    whole frames (multiples of 4 with SSE), as the fractional remainder is kept privately by the mixing thread.
+
+atomix pitch:
+    Any sound can be pitched with atomixMixerSetPitch, which multiplies with the Doppler shift of positional
+    sounds and is read the same way. Pitching up aliases unless the data is band-limited first, so sounds
+    created by atomixSoundNewAdv with ATOMIX_MIPMAP get half and quarter rate copies filtered at load time,
+    using 75% more memory. Voices then read the level that keeps the rate below 2 (4 times with the quarter
+    rate copy) with the same linear interpolation, so pitching up costs no more than pitching down. Between
+    the original rate and twice that some aliasing remains, which is the usual trade-off of mipmapping.
+
+atomix dual mono:
+    Stereo data given to atomixSoundNewAdv with ATOMIX_MONO is checked for left and right channels that are
+    the same within ATOMIX_MONO_TOL (one 16-bit step by default), comparing 4 frames at a time with SSE and
+    stopping at the first frame that differs. Such data is stored as a mono sound of their average instead,
+    which halves its memory and mixes it with the cheaper mono kernels at the same loudness and panning.
+    Check atomixSoundChannels after creation to find out which one it turned out to be.
+
+atomix integer formats:
+    Decoders producing 8, 16 or 24-bit integer samples can hand those to atomixSoundNewPCM, which converts
+    them straight into the aligned storage of the new sound without a temporary float buffer in between.
+    With SSE2 available (always on x86-64), 16 and 8-bit samples are widened and converted 8 or 16 at a time,
+    anything else is converted one sample at a time and scaled 4 at a time. Scaling is by the full range of
+    the format, so the most negative value maps to exactly -1, and all flags work as with float data.
+    Decoders that can write floats themselves can skip the copy entirely: atomixSoundAlloc allocates a sound
+    of the expected length, the decoder writes into atomixSoundData, and atomixSoundFinish pads the sound and
+    generates its mipmaps, shortening it if fewer frames were decoded than expected, or fails if none were.
+
+atomix unison:
+    A sound given more than one voice with atomixMixerSetUnison renders that many detuned copies from its one
+    layer, with rates spread evenly around its own and pans spread evenly around its own. Copies are computed
+    4 at a time in SSE lanes and summed with a transpose, while sharing the cursor, fade, and state handling
+    of the layer, so 8 voices cost far less than 8 layers. Copies of a looping sound wrap independently, the
+    sound as a whole ends when its center does. Unison sounds are always panned, even if binaural is enabled.
+
+atomix granular:
+    A sound given a grain size with atomixMixerSetGranular is rendered as a stream of short grains instead,
+    taken from around its cursor at random intervals, with random offsets, rates, and pans within the given
+    ranges. Grains are spawned and retired by the mixing thread itself, so a dense texture costs one layer
+    and one call instead of hundreds of short voices. Up to 16 grains per layer play at once, 4 at a time in
+    SSE lanes with their windows (squared parabolas, which are close to Hann windows) computed in the same
+    lanes. The cursor moves through the sound as usual, and no new grains start within one grain of the end
+    of a sound that does not loop, so that none are cut off. Granular sounds take precedence over unison.
+
+atomix loops:
+    A looping sound wraps around from its end to its start forever, unless given a loop count with
+    atomixMixerSetLoops, which the mixer counts down at each wrap. Once out of loops, or after a call to
+    atomixMixerRelease, the current pass finishes and the sound leaves its loop to play on past the end
+    given to atomixMixerPlayAdv, through to the end of the sound itself, before stopping. This makes a
+    sustain loop with a release tail a single voice, looping the middle of a sound while a key is held.
+    Releasing is not final: setting ATOMIX_LOOP again with atomixMixerSetState re-enters the loop given to
+    atomixMixerPlayAdv (wrapping back to its start right away if already past it), looping forever unless
+    given a new count with atomixMixerSetLoops.
+    The switch to ATOMIX_PLAY happens in the mixing thread, exactly at the end of the loop, and the end of
+    the sound after leaving the loop is owned by the mixer, so atomixMixerSetCursor clamps to the sound.
+
+atomix resampling:
+    Sounds recorded at another rate than the mixer can be converted once when created with atomixSoundNewRate,
+    so that they play at the right pitch on the regular kernels instead of needing a pitch on every voice.
+    Each output frame is filtered with a Blackman windowed sinc of 16 zero crossings either side of a cutoff
+    just below the lower nyquist frequency, from a table of up to 512 phases computed once per call, so ratios
+    of common rates like 44100 to 48000 use exact phases. Filtering multiplies 4 samples at a time with SSE,
+    stereo frames included, and keeps well over 90dB between signal and error for tones in the passband.
+
+atomix shared memory:
+    When ATOMIX_SHM is defined, atomixBankCreate creates a named shared memory region that sounds are added
+    to with atomixBankAdd, which lays them out exactly as atomixSoundNewAdv would (including mipmaps). Other
+    processes map the same region read-only with atomixBankAttach and get sounds with atomixBankSound, which
+    only allocate the small sound struct and point it at the shared data, so that the sound data is stored
+    once per host instead of once per process. The bank publishes each sound atomically after writing it,
+    so processes may attach while sounds are still being added and will see every sound up to the count.
+    Sounds taken from a bank are freed like any other sound, but must be freed before closing the bank.
+
+atomix registry:
+    Sounds created through a registry with atomixRegistrySound are hashed as they are created, and a sound
+    with identical content, channels, and flags is returned instead of storing another copy. The hash runs
+    4 independent lanes over the sample data, which pipeline well (and vectorize where integer SIMD is
+    available), and every match is verified in full, so a collision never returns the wrong sound. Each
+    returned sound counts as a reference given back with atomixRegistryRelease, and atomixRegistryStats
+    reports how many bytes sharing saved. Registries are used from the control thread only.
+
+atomix time budgets:
+    A mixer given a time budget with atomixMixerBudget reads ATOMIX_CLOCK as it mixes, going through active
+    layers from the highest priority set with atomixMixerSetPriority to the lowest (in mixing order within each).
+    Once another layer costing the average so far, together with virtualizing the layers after it at the cost
+    measured in previous mixes, would no longer fit into 15/16 of the budget, the remaining layers are
+    virtualized for this mix: their cursor, rate, fade, and loops advance exactly as if they had been mixed,
+    in a few jumps per layer without reading any data, so they come back in time next mix. How often this
+    happened, and how often the budget was exceeded nonetheless, is reported by atomixMixerStats.
+    Without a budget the clock is never read.
+
+atomix mixing order:
+    Layers are not mixed in the order of their handles but grouped by sound and by cursor within each sound,
+    so voices playing the same sound close to each other read the same sample data while it is still cached.
+    The mixer keeps an ordered list of active layers only, never scanning or sorting empty ones: layers started
+    since the previous mix are flagged in a bitmap and inserted at their place by binary search, stopped ones
+    are dropped, and an insertion sort over the list repairs the rest, which is close to linear as cursors
+    mostly advance together, and only looping, differently pitched, or reprioritized voices move.
+    With SSE, plain mono voices that play a whole mix without fading, looping around, or ending are queued
+    and mixed 4 at a time instead, multiplying the samples of each voice by its left and right gain into
+    planar sums that are interleaved into the output once per 4 voices rather than once per voice.
+
+atomix cost estimates:
+    atomixMixerCalibrate measures the mixing paths once by mixing internal noise in a scratch mixer: plain mono
+    and stereo, pitched, binaural, unison with 2 and 8 voices, and granular with 4 and 16 grains, each on top
+    of an empty mix and keeping the fastest of a few rounds over all of them. Unison is split into a cost per
+    layer and one per group of voices mixed at once (4 with SSE, 1 without), granular into a cost per layer
+    and one per grain. atomixMixerEstimate then goes over the layers of the real mixer without touching their
+    data, picks the path each one takes from its settings, counting the grains alive at once as grain size
+    over interval, and adds up the calibrated costs per frame, optionally with one more voice. Comparing the
+    estimate with the budget before starting a sound tells whether it would still be mixed or virtualized.
+    Estimates assume warm caches and a core running at the clock it was calibrated at, where they are
+    typically within a fifth of the actual cost, but since fades, loop ends, and mipmaps vary from mix to mix
+    they are a guide rather than a bound.
+
+atomix real-time:
+    When ATOMIX_MLOCK is defined, every sound and mixer is locked into memory with mlock when it is created,
+    which also faults in all of its pages, so the first mix of a sound nobody touched in a while never waits
+    on a page fault or on swap. Banks lock their whole mapping, the bank sounds only their small struct.
+    Only data is locked, so code paths still fault in on first use unless the program uses mlockall itself.
+    Locks are page granular and do not nest, so freeing with atomixSoundFree and atomixMixerFree only unlocks
+    the pages no other allocation shares. If the lock limit (RLIMIT_MEMLOCK) is reached the pages are still
+    written to fault them in, they just may be paged out again later. Atomix owns no threads of its own, so
+    atomixThreadRealtime is meant to be called once from the mixing thread, usually in the first callback of
+    an audio backend that does not already run it at real-time priority. It switches the calling thread to
+    SCHED_FIFO and faults in enough of its stack for mixing a few thousand frames.
+
+atomix tracing:
+    When ATOMIX_TRACE is defined, every public mixer function reports its arguments as a struct atomix_event
+    before returning (atomixMixerPlayAdv also reports the handle it returned, 0 on failure). The event only
+    lives for the duration of the call, so the hook must copy it, usually with a timestamp of its own, into
+    a preallocated buffer. The hook is called from both threads, so it must be thread-safe and should never
+    block or allocate when called for ATOMIX_TRACE_MIX. Sounds are reported by pointer, which the recording
+    side is expected to map to something stable across runs (like the order in which sounds were loaded).
+
+atomix profiling:
+    When ATOMIX_PROFILE is defined, the mixer reads ATOMIX_CLOCK before and after mixing each active layer
+    and adds the difference to the sound that layer is playing, along with which path was taken. Counters
+    are per sound rather than per layer, so that a sound played from many layers (or mixers) shows its full
+    cost. Every active layer costs two clock reads and a few atomic additions, so only profile when needed.
+
 atomix limits (SSE):
     The atomixMixerMix function uses a buffer on the stack which scales with the number of frames requested,
     therefore requesting an excessively high number of frames at once will likely result in a stack overflow.
@@ -72,13 +246,78 @@ atomix limits (non-SSE):
 #define ATOMIX_HALT 2
 #define ATOMIX_PLAY 3
 #define ATOMIX_LOOP 4
+#define ATOMIX_MIPMAP 1 //atomixSoundNewAdv: generate half and quarter rate copies for pitching up
+#define ATOMIX_MONO 2 //atomixSoundNewAdv: store stereo data with identical left and right as mono
+
+//sample formats
+#define ATOMIX_U8 1 //atomixSoundNewPCM: unsigned 8-bit
+#define ATOMIX_S16 2 //atomixSoundNewPCM: signed 16-bit
+#define ATOMIX_S24 3 //atomixSoundNewPCM: signed 24-bit packed in 3 bytes, little-endian
+#define ATOMIX_TRACE_NEW 1 //atomixMixerNew: gain = volume, a = fade
+#define ATOMIX_TRACE_MIX 2 //atomixMixerMix: a = number of frames
+#define ATOMIX_TRACE_PLAY 3 //atomixMixerPlayAdv: id = returned handle, snd, flag, gain, pan, a = start, b = end, c = fade
+#define ATOMIX_TRACE_GAINPAN 4 //atomixMixerSetGainPan: id, gain, pan
+#define ATOMIX_TRACE_CURSOR 5 //atomixMixerSetCursor: id, a = cursor
+#define ATOMIX_TRACE_STATE 6 //atomixMixerSetState: id, flag
+#define ATOMIX_TRACE_VOLUME 7 //atomixMixerVolume: gain = volume
+#define ATOMIX_TRACE_FADE 8 //atomixMixerFade: a = fade
+#define ATOMIX_TRACE_STOPALL 9 //atomixMixerStopAll
+#define ATOMIX_TRACE_HALTALL 10 //atomixMixerHaltAll
+#define ATOMIX_TRACE_PLAYALL 11 //atomixMixerPlayAll
+#define ATOMIX_TRACE_DIRECTION 12 //atomixMixerSetDirection: id, x, y, z
+#define ATOMIX_TRACE_LISTENER 13 //atomixMixerListener: x = yaw, y = pitch, z = roll
+#define ATOMIX_TRACE_BINAURAL 14 //atomixMixerBinaural: a = sample rate
+#define ATOMIX_TRACE_VELOCITY 15 //atomixMixerSetVelocity: id, x, y, z
+#define ATOMIX_TRACE_PITCH 16 //atomixMixerSetPitch: id, gain = pitch
+#define ATOMIX_TRACE_UNISON 17 //atomixMixerSetUnison: id, flag = voices, x = detune, y = spread
+#define ATOMIX_TRACE_GRANULAR 18 //atomixMixerSetGranular: id, a = size, b = interval, c = scatter, x = pitch, y = spread
+#define ATOMIX_TRACE_LOOPS 19 //atomixMixerSetLoops: id, a = count
+#define ATOMIX_TRACE_RELEASE 20 //atomixMixerRelease: id
+#define ATOMIX_TRACE_PRIORITY 21 //atomixMixerSetPriority: id, flag = priority
+#define ATOMIX_TRACE_BUDGET 22 //atomixMixerBudget: a = clock ticks
 
 //includes
 #include <stdint.h> //integer types
+#ifdef ATOMIX_SHM
+    #include <stddef.h> //size_t
+#endif
 
 //structs
 struct atomix_mixer; //forward declaration
 struct atomix_sound; //forward declaration
+struct atomix_registry; //forward declaration
+#ifdef ATOMIX_SHM
+struct atomix_bank; //forward declaration
+#endif
+struct atomix_event {
+    uint8_t type; //one of the ATOMIX_TRACE_XXX constants
+    uint8_t flag; //state flag
+    uint32_t id; //sound handle
+    struct atomix_sound* snd; //sound
+    float gain, pan; //gain and pan
+    int32_t a, b, c; //integer arguments
+    float x, y, z; //vector arguments
+};
+struct atomix_dedup {
+    uint64_t sounds; //distinct sounds stored
+    uint64_t refs; //references held to them
+    uint64_t bytes; //bytes of sound data stored
+    uint64_t saved; //bytes of sound data not stored thanks to sharing
+};
+struct atomix_stats {
+    uint64_t mixes; //mixes under a time budget
+    uint64_t degraded; //mixes that virtualized layers to stay within the budget
+    uint64_t virtualized; //layers virtualized in total
+    uint64_t overruns; //mixes that exceeded the budget nonetheless
+};
+#ifdef ATOMIX_PROFILE
+struct atomix_profile {
+    uint64_t cycles; //clock cycles spent mixing
+    uint64_t calls; //number of times mixed
+    uint64_t fades; //times mixed while fading in or out
+    uint64_t wraps; //times the cursor looped around
+};
+#endif
 
 //function declarations
 ATMXDEF struct atomix_sound* atomixSoundNew(uint8_t, float*, int32_t);
@@ -86,10 +325,49 @@ ATMXDEF struct atomix_sound* atomixSoundNew(uint8_t, float*, int32_t);
     //length of data is in frames and rounded to multiple of 4 for alignment
     //given data is copied, so the buffer can safely be freed after return
     //returns a pointer to the new atomix sound or NULL on failure
+ATMXDEF struct atomix_sound* atomixSoundNewAdv(uint8_t, float*, int32_t, uint8_t);
+    //same as atomixSoundNew but with additional flags, which may be 0 or any combination of ATOMIX_XXX flags
+    //ATOMIX_MIPMAP generates band-limited half and quarter rate copies for voices pitched up
+    //ATOMIX_MONO stores stereo data as mono if left and right are the same within a tolerance
+ATMXDEF struct atomix_sound* atomixSoundNewPCM(uint8_t, const void*, int32_t, uint8_t, uint8_t);
+    //same as atomixSoundNewAdv but with integer data in the ATOMIX_XXX sample format given before the flags
+    //samples are converted straight into the sound, scaled to the -1 to 1 range of floats
+ATMXDEF struct atomix_sound* atomixSoundNewRate(uint8_t, float*, int32_t, uint8_t, uint32_t, uint32_t);
+    //same as atomixSoundNewAdv but with data at the first given sample rate, resampled to the second
+    //the length of the new sound is the length of the data at the second rate, rounded to multiple of 4
+ATMXDEF struct atomix_sound* atomixSoundAlloc(uint8_t, int32_t, uint8_t);
+    //allocates a new atomix sound with given number of channels, length and flags to be filled in place
+    //write up to that many interleaved frames to atomixSoundData and call atomixSoundFinish before playing it
+    //ATOMIX_MONO is ignored, as the channels are fixed before there is any data to check
+    //returns a pointer to the new atomix sound or NULL on failure
+ATMXDEF float* atomixSoundData(struct atomix_sound*);
+    //returns the aligned data of a sound from atomixSoundAlloc, with room for as many frames as allocated
+ATMXDEF int atomixSoundFinish(struct atomix_sound*, int32_t);
+    //finishes a sound from atomixSoundAlloc after given number of frames were written to its data
+    //fewer frames than allocated shorten the sound accordingly, the memory for the rest is not returned
+    //returns 0 on success, non-zero if no frames were written, leaving the sound unplayable to be freed
 ATMXDEF int32_t atomixSoundLength(struct atomix_sound*);
     //returns the length of given sound in frames, always multiple of 4
+ATMXDEF uint8_t atomixSoundChannels(struct atomix_sound*);
+    //returns the number of channels of given sound as stored, 1 if stereo data was collapsed to mono
+ATMXDEF void atomixSoundFree(struct atomix_sound*);
+    //frees given sound, which must no longer be playing, unlocking its memory first if ATOMIX_MLOCK
+    //same as passing it to the function matching ATOMIX_ZALLOC otherwise, which remains valid to use
+ATMXDEF struct atomix_registry* atomixRegistryNew(void);
+    //returns a new empty sound registry or NULL on failure to allocate
+ATMXDEF struct atomix_sound* atomixRegistrySound(struct atomix_registry*, uint8_t, float*, int32_t, uint8_t);
+    //same as atomixSoundNewAdv but returns the registered sound instead if its content and flags are identical
+    //every returned sound holds a reference, which must be given back with atomixRegistryRelease
+ATMXDEF int atomixRegistryRelease(struct atomix_registry*, struct atomix_sound*);
+    //gives back a reference to given sound from given registry, returns 1 if it was the last one, 0 if not
+    //the sound is then no longer registered and should be freed by the caller once it stopped playing
+    //returns -1 without changing anything if the registry holds no reference to given sound
+ATMXDEF void atomixRegistryStats(struct atomix_registry*, struct atomix_dedup*);
+    //copies the number of sounds, references, bytes stored, and bytes saved by given registry into given struct
 ATMXDEF struct atomix_mixer* atomixMixerNew(float, int32_t);
     //returns a new atomix mixer with given volume and fade or NULL on failure to allocate
+ATMXDEF void atomixMixerFree(struct atomix_mixer*);
+    //frees given mixer, which must no longer be mixing, unlocking its memory first if ATOMIX_MLOCK
 ATMXDEF uint32_t atomixMixerMix(struct atomix_mixer*, float*, uint32_t);
     //uses given atomix mixer to output exactly the requested number of frames to given buffer
     //returns the number of frames actually written to the buffer, buffer must not be NULL
@@ -113,8 +391,60 @@ ATMXDEF int atomixMixerSetState(struct atomix_mixer*, uint32_t, uint8_t);
     //sets the state for the sound with given handle in given mixer
     //given state must be one of the ATOMIX_XXX define constants
     //returns 0 on success, non-zero if the handle is invalid
+ATMXDEF int atomixMixerSetDirection(struct atomix_mixer*, uint32_t, float, float, float);
+    //sets the direction of the sound with given handle in given mixer, making it positional
+    //x is forward, y is left, z is up, length is ignored, a zero vector makes it non-positional
+    //returns non-zero on success, 0 if the handle is invalid
+ATMXDEF int atomixMixerSetVelocity(struct atomix_mixer*, uint32_t, float, float, float);
+    //sets the velocity of the sound with given handle in given mixer relative to the listener in meters per second
+    //pitches positional sounds by the Doppler effect, which combined with the pitch is clamped to two octaves
+    //returns non-zero on success, 0 if the handle is invalid
+ATMXDEF int atomixMixerSetPitch(struct atomix_mixer*, uint32_t, float);
+    //sets the playback rate of the sound with given handle in given mixer, 1.0 being the original rate
+    //pitch is clamped to between 0.25 and 4.0, with smooth changes in between mixes
+    //returns non-zero on success, 0 if the handle is invalid
+ATMXDEF int atomixMixerSetUnison(struct atomix_mixer*, uint32_t, uint8_t, float, float);
+    //renders the sound with given handle in given mixer as given number of detuned copies (1 to 8)
+    //detune is the largest rate deviation of a copy (0.01 is about 17 cents), spread the largest pan offset
+    //returns non-zero on success, 0 if the handle is invalid
+ATMXDEF int atomixMixerSetGranular(struct atomix_mixer*, uint32_t, int32_t, int32_t, int32_t, float, float);
+    //renders the sound with given handle in given mixer as short windowed grains taken around its cursor
+    //size is the grain length in frames (0 disables), interval the average number of frames between grains
+    //scatter is the largest position offset in frames, pitch the largest rate deviation, spread the largest pan offset
+    //returns non-zero on success, 0 if the handle is invalid
+ATMXDEF int atomixMixerSetLoops(struct atomix_mixer*, uint32_t, int32_t);
+    //sets the number of times the sound with given handle in given mixer wraps around while in the ATOMIX_LOOP state
+    //a negative count loops forever (the default), once out of loops the sound plays on to the end and stops
+    //returns non-zero on success, 0 if the handle is invalid
+ATMXDEF int atomixMixerRelease(struct atomix_mixer*, uint32_t);
+    //releases the sound with given handle in given mixer from its loop, same as atomixMixerSetLoops with 0
+    //the current pass of the loop finishes, then the sound plays on past the loop to the end of the sound
+    //setting ATOMIX_LOOP again with atomixMixerSetState afterwards re-enters the loop, looping forever
+    //returns non-zero on success, 0 if the handle is invalid
+ATMXDEF int atomixMixerSetPriority(struct atomix_mixer*, uint32_t, uint8_t);
+    //sets the priority of the sound with given handle in given mixer, 0 (the default) being the lowest
+    //under a time budget higher priorities mix first and lower ones are virtualized when out of time
+    //returns non-zero on success, 0 if the handle is invalid
 ATMXDEF void atomixMixerVolume(struct atomix_mixer*, float);
     //sets the global volume for given atomix mixer, may be any float including negative
+ATMXDEF void atomixMixerBudget(struct atomix_mixer*, uint32_t);
+    //sets the time budget of each atomixMixerMix call of given mixer in ATOMIX_CLOCK ticks, 0 (the default) disables it
+ATMXDEF void atomixMixerStats(struct atomix_mixer*, struct atomix_stats*, int);
+    //copies how often given mixer had to degrade to stay within its time budget into given stats struct
+    //if the last argument is non-zero the counters are reset to zero after copying
+ATMXDEF int atomixMixerCalibrate(struct atomix_mixer*);
+    //measures the cost of each mixing path for given mixer by mixing internal sounds in a scratch mixer
+    //takes a few dozen milliseconds and is best called once at startup, the estimates below stay 0 until it is
+    //returns non-zero on success, 0 if allocation failed
+ATMXDEF uint64_t atomixMixerEstimate(struct atomix_mixer*, uint32_t, struct atomix_sound*);
+    //estimates the ATOMIX_CLOCK ticks of mixing given number of frames with the sounds currently playing
+    //in given mixer, plus one more playing given sound unless NULL, comparable with atomixMixerBudget
+ATMXDEF void atomixMixerListener(struct atomix_mixer*, float, float, float);
+    //sets the listener orientation for positional sounds in given mixer as yaw, pitch, and roll in radians
+    //yaw turns left, pitch looks up, roll tilts the left ear up, all zero means facing along positive x
+ATMXDEF void atomixMixerBinaural(struct atomix_mixer*, int32_t);
+    //enables binaural rendering of positional sounds in given mixer at given output sample rate in Hz
+    //a sample rate of 0 disables binaural rendering, returning to stereo panning for positional sounds
 ATMXDEF void atomixMixerFade(struct atomix_mixer*, int32_t);
     //sets the global default fade value applied to all new sounds added after this command
 ATMXDEF void atomixMixerStopAll(struct atomix_mixer*);
@@ -123,6 +453,36 @@ ATMXDEF void atomixMixerHaltAll(struct atomix_mixer*);
     //halts all sounds currently playing in given mixer, allowing them to be resumed later
 ATMXDEF void atomixMixerPlayAll(struct atomix_mixer*);
     //resumes all halted sounds in given mixer, no effect on looping or stopped sounds
+#ifdef ATOMIX_PROFILE
+ATMXDEF void atomixSoundProfile(struct atomix_sound*, struct atomix_profile*, int);
+    //copies the accumulated mixing costs of given sound into given profile struct
+    //if the last argument is non-zero the counters are reset to zero after copying
+#endif
+#ifdef ATOMIX_SHM
+ATMXDEF struct atomix_bank* atomixBankCreate(const char*, size_t);
+    //creates (or replaces) a named shared memory bank of given size in bytes, mapped writable
+    //a replaced bank is unlinked rather than overwritten, so processes still attached to it keep its sounds
+    //returns a pointer to the new bank or NULL on failure, the name must start with a slash
+ATMXDEF struct atomix_bank* atomixBankAttach(const char*);
+    //maps an existing named shared memory bank read-only, returns NULL on failure
+ATMXDEF struct atomix_sound* atomixBankAdd(struct atomix_bank*, uint8_t, float*, int32_t, uint8_t);
+    //same as atomixSoundNewAdv but storing the data in given bank, which must have been created
+    //returns a pointer to the new atomix sound or NULL on failure, including when the bank is full
+ATMXDEF struct atomix_sound* atomixBankSound(struct atomix_bank*, int32_t);
+    //returns a new atomix sound using the data of the sound with given index in given bank without copying it
+    //indices count from 0 in the order sounds were added, returns NULL if out of range, if a record on the way is
+    //malformed or overruns the mapping, or on failure to allocate, looking up indices in order takes constant time
+ATMXDEF int32_t atomixBankCount(struct atomix_bank*);
+    //returns the number of sounds in given bank so far
+ATMXDEF void atomixBankClose(struct atomix_bank*, int);
+    //unmaps given bank, which may then be freed, removing its name if the last argument is non-zero
+    //sounds taken from the bank must be freed first, already attached processes keep their mapping
+#endif
+#ifdef ATOMIX_MLOCK
+ATMXDEF int atomixThreadRealtime(int);
+    //switches the calling thread to SCHED_FIFO with given priority, clamped to the valid range, and faults in its stack
+    //returns non-zero on success, 0 if not permitted (which needs CAP_SYS_NICE or a suitable RLIMIT_RTPRIO)
+#endif
 
 #endif //ATOMIX_H
 
@@ -135,20 +495,63 @@ ATMXDEF void atomixMixerPlayAll(struct atomix_mixer*);
     #include <stdlib.h> //calloc
     #define ATOMIX_ZALLOC(S) calloc(1, S)
 #endif
+#ifndef ATOMIX_FREE
+    #include <stdlib.h> //free
+    #define ATOMIX_FREE(P) free(P)
+#endif
 #define ATMX_STORE(A, C) atomic_store_explicit(A, C, memory_order_release)
 #define ATMX_LOAD(A) atomic_load_explicit(A, memory_order_acquire)
 #define ATMX_CSWAP(A, E, C) atomic_compare_exchange_strong_explicit(A, E, C, memory_order_acq_rel, memory_order_acquire)
+#ifdef ATOMIX_TRACE
+    #define ATMX_TRACE(M, T, F, I, S, G, P, A, B, C, X, Y, Z) atmxTrace(M, T, F, I, S, G, P, A, B, C, X, Y, Z)
+#else
+    #define ATMX_TRACE(M, T, F, I, S, G, P, A, B, C, X, Y, Z)
+#endif
 
 //constants
 #ifndef ATOMIX_LBITS
     #define ATOMIX_LBITS 8
 #endif
+#ifndef ATOMIX_MONO_TOL
+    #define ATOMIX_MONO_TOL (1.0f/32768.0f)
+#endif
 #define ATMX_LAYERS (1 << ATOMIX_LBITS)
 #define ATMX_LMASK (ATMX_LAYERS - 1)
+#define ATMX_FRESH ((ATMX_LAYERS + 31)/32) //words of the bitmap of started layers
+#define ATMX_BHIST 64 //binaural delay line length, enough for 96000Hz
+#define ATMX_BHEAD 0.0875f //binaural head radius in meters
+#define ATMX_SPEED 343.0f //speed of sound in meters per second
+#define ATMX_MIPTAPS 31 //mipmap halfband filter length
+#define ATMX_SRCZEROS 16 //resampling filter zero crossings either side
+#define ATMX_SRCPHASES 512 //maximum resampling filter phases
+#define ATMX_UNISON 8 //maximum number of unison voices
+#define ATMX_GRAINS 16 //maximum number of grains per layer
+#define ATMX_BMAGIC 0x584d5441 //shared memory bank magic number
+#define ATMX_RBUCKETS 1024 //number of registry hash buckets
+#define ATMX_STACK 131072 //bytes of stack faulted in by atomixThreadRealtime
+
+//profiling and time budget clock
+#ifndef ATOMIX_CLOCK
+    #if defined(__x86_64__)||defined(__i386__)||defined(_M_X64)||defined(_M_IX86)
+        #ifdef _MSC_VER
+            #include <intrin.h> //__rdtsc
+        #else
+            #include <x86intrin.h> //__rdtsc
+        #endif
+        #define ATOMIX_CLOCK() __rdtsc()
+    #else
+        #include <time.h> //clock
+        #define ATOMIX_CLOCK() ((uint64_t)clock())
+    #endif
+#endif
 
 //includes
 #ifndef ATOMIX_NO_SSE
     #include <xmmintrin.h> //SSE intrinsics
+    #if defined(__SSE2__)||defined(_M_X64)||(defined(_M_IX86_FP)&&(_M_IX86_FP >= 2))
+        #include <emmintrin.h> //SSE2 integer conversion
+        #define ATMX_SSE2
+    #endif
 #endif
 #ifndef __cplusplus
     #include <stdatomic.h> //atomics
@@ -158,85 +561,374 @@ ATMXDEF void atomixMixerPlayAll(struct atomix_mixer*);
     #define _Atomic(X) atomic<X>
 #endif
 #include <string.h> //memcpy
+#include <math.h> //sinf, cosf, acosf, sqrtf
+#ifdef ATOMIX_SHM
+    #include <sys/mman.h> //shm_open, mmap
+    #include <sys/stat.h> //fstat
+    #include <fcntl.h> //O_CREAT
+    #include <unistd.h> //ftruncate, close
+#endif
+#ifdef ATOMIX_MLOCK
+    #include <sys/mman.h> //mlock, munlock
+    #include <unistd.h> //sysconf
+    #include <pthread.h> //pthread_setschedparam
+    #include <sched.h> //SCHED_FIFO
+#endif
 
 //structs
 struct atomix_sound {
     uint8_t cha; //channels
     int32_t len; //data length
+    #ifdef ATOMIX_PROFILE
+        _Atomic(uint64_t) prof[4]; //profiling counters
+    #endif
+    float* mip[2]; //half and quarter rate data or NULL
+    uint64_t hash; uint32_t refs; //content hash and reference count if registered
+    struct atomix_sound* next; //next sound in the same registry bucket
+    #ifdef ATOMIX_MLOCK
+        size_t lock; //bytes locked from the start of the struct
+    #endif
     #ifndef ATOMIX_NO_SSE
         __m128* data; //aligned data
     #else
-        float data[]; //float data
+        float* data; //float data
     #endif
 };
+#ifndef ATOMIX_NO_SSE
+struct atmx_batch {
+    __m128* src[4]; //data of queued mono voices at their cursors
+    float gl[4], gr[4]; //left and right gains of queued mono voices
+    int num; //number of queued mono voices
+};
+#endif
+struct atmx_okey {
+    uint16_t rank; int32_t cur; //255 minus priority, and cursor
+    uintptr_t snd; //sound address
+};
 struct atmx_f2 {
     float l, r; //left/right floats
 };
+struct atmx_binaural {
+    float hist[ATMX_BHIST]; //mono delay line
+    uint32_t w; //delay line write position
+    float del[2]; //left/right delay in frames
+    float b0[2], b1[2]; //left/right head shadow filter coefficients
+    float x1[2], y1[2]; //left/right filter state
+    int on; //state is current
+};
+struct atmx_unison {
+    float off[ATMX_UNISON]; //copy positions relative to the cursor
+    int on; //state is current
+};
+struct atmx_granular {
+    int32_t base[ATMX_GRAINS]; //grain start frames, multiples of 4
+    float off[ATMX_GRAINS], rate[ATMX_GRAINS]; //grain positions relative to their start and playback rates
+    float age[ATMX_GRAINS], len[ATMX_GRAINS], ilen[ATMX_GRAINS]; //grain ages and lengths, inverse length 0 if free
+    float gl[ATMX_GRAINS], gr[ATMX_GRAINS]; //grain left/right gains
+    int32_t size, ival, scat; //grain size, interval, and scatter of current mix
+    float pit, spr, gain, pan; //pitch deviation, pan spread, gain, and pan of current mix
+    int32_t next; //frames until the next grain
+    uint32_t seed; //random state
+    int on; //state is current
+};
 struct atmx_layer {
     uint32_t id; //playing id
     _Atomic(uint8_t) flag; //state
     _Atomic(int32_t) cursor; //cursor
     _Atomic(struct atmx_f2) gain; //gain
+    _Atomic(float) dir[3]; //direction
+    _Atomic(float) vel[3]; //velocity
+    _Atomic(float) pitch; //pitch
+    _Atomic(uint8_t) uni; //unison voices
+    _Atomic(float) udet, uspr; //unison detune and spread
+    _Atomic(int32_t) gsize, gival, gscat; //grain size, interval, and scatter
+    _Atomic(float) gpit, gspr; //grain pitch deviation and pan spread
     struct atomix_sound* snd; //sound data
-    int32_t start, end; //start and end
+    int32_t start, end, tail; //start, end (of the loop while looping), and end after leaving the loop
+    int32_t lend; //end of the loop, kept for looping again after leaving it
+    _Atomic(int32_t) loops; //remaining loops, negative if forever
+    _Atomic(uint8_t) prio; //priority under a time budget
     int32_t fade, fmax; //fading
+    struct atmx_binaural bin; //binaural state
+    struct atmx_unison unis; //unison state
+    struct atmx_granular gran; //granular state
+    float rate, frac; //current playback rate and fractional cursor
+    float trate; //target playback rate of current mix
+    uint8_t listed; //in the mixing order, owned by the mixer thread
 };
 struct atomix_mixer {
     uint32_t nid; //next id
     _Atomic(float) volume; //global volume
     struct atmx_layer lays[ATMX_LAYERS]; //layers
     int32_t fade; //global default fade value
+    _Atomic(float) lis[3]; //listener yaw, pitch, roll
+    float left[3]; //listener left axis of current mix
+    _Atomic(int32_t) brate; //binaural sample rate
+    float bhead, bk, bt, ba1; //binaural constants of current mix
+    _Atomic(uint32_t) budget; //clock ticks per mix, 0 if unlimited
+    _Atomic(uint64_t) stats[4]; //time budget counters
+    uint32_t vcost; //clock ticks to virtualize a layer, measured under a budget
+    _Atomic(uint32_t) fresh[ATMX_FRESH]; //bitmap of layers started since the previous mix
+    uint16_t order[ATMX_LAYERS]; //active layers in mixing order, kept from one mix to the next
+    int act; //number of layers in mixing order
+    struct atmx_okey okey[ATMX_LAYERS]; //mixing order keys of current mix
+    float cost[9]; //calibrated clock ticks per frame of each mixing path, unison voices, grain, and of the mix itself
     #ifndef ATOMIX_NO_SSE
         uint32_t rem; //remaining frames
         float data[6]; //old frames
+        struct atmx_batch batch; //mono voices queued for mixing 4 at once
     #endif
 };
 
+struct atomix_registry {
+    struct atomix_sound* bkt[ATMX_RBUCKETS]; //hash buckets of sounds
+    struct atomix_dedup stats; //statistics
+};
+#ifdef ATOMIX_SHM
+struct atomix_bank {
+    unsigned char* base; //mapped memory
+    size_t size; //mapped size
+    int write; //created rather than attached
+    char name[256]; //shared memory name
+    int32_t idx; size_t off; //index and offset of the record last looked up
+};
+struct atmx_bankhead {
+    uint32_t magic; //ATMX_BMAGIC once initialized
+    _Atomic(int32_t) count; //number of complete sounds
+    uint64_t used; //bytes used including this header
+};
+struct atmx_bankrec {
+    int32_t cha, len, flags, pad; //channels, rounded length, and flags of the following data
+};
+#endif
+
 //function declarations
 #ifndef ATOMIX_NO_SSE
-    static void atmxMixLayer(struct atmx_layer*, __m128, __m128*, uint32_t);
+    static void atmxMixLayer(struct atomix_mixer*, struct atmx_layer*, __m128, __m128*, uint32_t, int);
+    static int32_t atmxMixBinaural(struct atomix_mixer*, struct atmx_layer*, uint8_t, int32_t, float, float, float, __m128*, uint32_t);
+    static int32_t atmxMixPitch(struct atmx_layer*, uint8_t, int32_t, float, __m128, __m128*, uint32_t);
+    static __m128 atmxMixMono4(struct atomix_sound*, int32_t);
+    static int32_t atmxMixRead4(struct atomix_sound*, int, int32_t, float*, float*, float, __m128*, __m128*);
+    static int32_t atmxMixUnison(struct atmx_layer*, uint8_t, int32_t, float, int, struct atmx_f2, __m128*, uint32_t);
+    static int32_t atmxMixGranular(struct atmx_layer*, uint8_t, int32_t, float, struct atmx_f2, __m128*, uint32_t);
     static int32_t atmxMixFadeMono(struct atmx_layer*, int32_t, __m128, __m128*, uint32_t);
     static int32_t atmxMixFadeStereo(struct atmx_layer*, int32_t, __m128, __m128*, uint32_t);
     static int32_t atmxMixPlayMono(struct atmx_layer*, int, int32_t, __m128, __m128*, uint32_t);
     static int32_t atmxMixPlayStereo(struct atmx_layer*, int, int32_t, __m128, __m128*, uint32_t);
+    static int atmxMixBatchable(struct atmx_layer*, int32_t, uint32_t);
+    static int32_t atmxMixQueue(struct atomix_mixer*, struct atmx_layer*, int32_t, struct atmx_f2, __m128*, uint32_t);
+    static void atmxMixBatch(struct atmx_batch*, __m128*, uint32_t);
 #else
-    static void atmxMixLayer(struct atmx_layer*, float, float*, uint32_t);
+    static void atmxMixLayer(struct atomix_mixer*, struct atmx_layer*, float, float*, uint32_t, int);
+    static int32_t atmxMixBinaural(struct atomix_mixer*, struct atmx_layer*, uint8_t, int32_t, float, float, float, float*, uint32_t);
+    static int32_t atmxMixPitch(struct atmx_layer*, uint8_t, int32_t, float, struct atmx_f2, float*, uint32_t);
+    static float atmxMixMono1(struct atomix_sound*, int32_t);
+    static int32_t atmxMixRead1(struct atomix_sound*, int, int32_t, float*, float*, float, float*, float*);
+    static int32_t atmxMixUnison(struct atmx_layer*, uint8_t, int32_t, float, int, struct atmx_f2, float*, uint32_t);
+    static int32_t atmxMixGranular(struct atmx_layer*, uint8_t, int32_t, float, struct atmx_f2, float*, uint32_t);
     static int32_t atmxMixFadeMono(struct atmx_layer*, int32_t, struct atmx_f2, float*, uint32_t);
     static int32_t atmxMixFadeStereo(struct atmx_layer*, int32_t, struct atmx_f2, float*, uint32_t);
     static int32_t atmxMixPlayMono(struct atmx_layer*, int, int32_t, struct atmx_f2, float*, uint32_t);
     static int32_t atmxMixPlayStereo(struct atmx_layer*, int, int32_t, struct atmx_f2, float*, uint32_t);
 #endif
+static size_t atmxSoundBytes(uint8_t, int32_t, uint8_t);
+static void atmxSoundInit(struct atomix_sound*, uint8_t, int32_t, uint8_t, void*);
+static struct atomix_sound* atmxSoundAlloc(uint8_t, int32_t, uint8_t);
+static void atmxSoundFill(struct atomix_sound*, float*, int32_t, uint8_t);
+static void atmxSoundConvert(struct atomix_sound*, const void*, int32_t, uint8_t, uint8_t);
+static void atmxSoundFinish(struct atomix_sound*, int32_t);
+static float* atmxResampleTable(uint8_t, uint64_t, uint64_t, int32_t*);
+static void atmxResample(struct atomix_sound*, float*, int32_t, uint8_t, uint64_t, uint64_t, float*, int32_t);
+static uint8_t atmxSoundChannels(uint8_t, float*, int32_t, uint8_t);
+#ifdef ATOMIX_SHM
+static size_t atmxBankRecord(struct atomix_bank*, size_t, struct atmx_bankrec*);
+#endif
+#ifdef ATOMIX_MLOCK
+static void atmxLock(void*, size_t, int);
+static void atmxUnlock(void*, size_t);
+#endif
+static float atmxPCM(const void*, uint8_t, int32_t);
+static float atmxPCMScale(uint8_t);
+static int atmxSoundSame(struct atomix_sound*, float*, int32_t, uint8_t);
+static uint64_t atmxHash(float*, size_t);
 static struct atmx_f2 atmxGainf2(float, float);
+static uint32_t atmxMix(struct atomix_mixer*, float*, uint32_t);
+static void atmxLayerInit(struct atomix_mixer*, struct atmx_layer*, uint32_t, struct atomix_sound*, uint8_t, float, float, int32_t, int32_t, int32_t);
+static float atmxLayerCost(struct atomix_mixer*, struct atmx_layer*);
+static float atmxCalibrate(struct atomix_mixer*, struct atomix_sound*, int);
+static int atmxUnisonWidth(int);
+static void atmxMixSetup(struct atomix_mixer*);
+static int atmxMixOrder(struct atomix_mixer*);
+static void atmxMixKey(struct atmx_layer*, struct atmx_okey*);
+static int atmxMixBefore(struct atmx_okey*, struct atmx_okey*);
+static int atmxMixOver(struct atomix_mixer*, uint64_t, uint32_t, int, int);
+static void atmxMixStats(struct atomix_mixer*, uint64_t, uint32_t, int, uint64_t);
+static int32_t atmxMixSkip(struct atmx_layer*, uint8_t, int32_t, float, uint32_t, int32_t);
+static int atmxDirection(struct atomix_mixer*, struct atmx_layer*, float*);
+static int atmxMixMode(struct atmx_layer*, uint8_t, int32_t, float);
+static float atmxMixBegin(struct atmx_layer*, int, int*, int32_t*);
+static int atmxMixWrap(struct atmx_layer*, int, int*, int32_t*);
+static int atmxMixLoop(struct atmx_layer*, int*, int32_t*);
+static void atmxMixAdvance(struct atmx_layer*, int, int32_t*, int32_t, int32_t);
+static int atmxPitched(struct atmx_layer*, float);
+static float atmxMixRate(struct atmx_layer*, float, float);
+static int atmxMixLevel(struct atomix_sound*, float);
+static void atmxMixFrame(struct atomix_sound*, int, int32_t, float*, float*);
+static void atmxMixRates(struct atomix_mixer*, int);
+static float atmxRate(struct atmx_layer*);
+static float atmxUnisonSetup(struct atmx_layer*, int, struct atmx_f2, float*, float*, float*);
+static void atmxMixRange(struct atmx_layer*, int, int, int32_t, int32_t*, int32_t*);
+static void atmxMixTap(struct atmx_layer*, float*, int, int, int, int32_t, int32_t, int32_t, float, float*);
+static int32_t atmxLoopIndex(struct atmx_layer*, int, int, int32_t, int32_t);
+static float atmxGrainSetup(struct atmx_layer*, struct atmx_f2);
+static void atmxGrainTick(struct atmx_layer*, int, int32_t, float, float, int32_t);
+static void atmxGrainSpawn(struct atmx_layer*, int, int32_t, float, float);
+static float atmxGrainRandom(uint32_t*);
+static void atmxDecimate(float*, int32_t, uint8_t, float*);
+static void atmxBinauralTarget(struct atomix_mixer*, float, float*, float*, float*);
+#ifdef ATOMIX_PROFILE
+    static void atmxProfile(struct atomix_sound*, uint64_t, int, int);
+#endif
+#ifdef ATOMIX_TRACE
+    static void atmxTrace(struct atomix_mixer*, uint8_t, uint8_t, uint32_t, struct atomix_sound*, float, float, int32_t, int32_t, int32_t, float, float, float);
+#endif
 
 //public functions
 ATMXDEF struct atomix_sound* atomixSoundNew (uint8_t cha, float* data, int32_t len) {
+    //regular sound without any flags
+    return atomixSoundNewAdv(cha, data, len, 0);
+}
+ATMXDEF struct atomix_sound* atomixSoundNewAdv (uint8_t cha, float* data, int32_t len, uint8_t flags) {
     //validate arguments first and return NULL if invalid
     if ((cha < 1)||(cha > 2)||(!data)||(len < 1)) return NULL;
-    //round length to next multiple of 4
-    int32_t rlen = (len + 3) & ~0x03;
-    //allocate sound struct and space for data
-    #ifndef ATOMIX_NO_SSE
-        struct atomix_sound* snd = (struct atomix_sound*)ATOMIX_ZALLOC(sizeof(struct atomix_sound) + rlen*cha*sizeof(float) + 15);
-    #else
-        struct atomix_sound* snd = (struct atomix_sound*)ATOMIX_ZALLOC(sizeof(struct atomix_sound) + rlen*cha*sizeof(float));
-    #endif
-    //return if zalloc failed
+    //allocate sound with the channels to store, return if that failed
+    struct atomix_sound* snd = atmxSoundAlloc(atmxSoundChannels(cha, data, len, flags), len, flags);
     if (!snd) return NULL;
-    //fill in channel and length
-    snd->cha = cha; snd->len = rlen;
-    //align data pointer in allocated space if SSE
-    #ifndef ATOMIX_NO_SSE
-        snd->data = (__m128*)(void*)(((uintptr_t)(void*)&snd[1] + 15) & ~15);
-    #endif
-    //copy sound data into now aligned buffer
-    memcpy(snd->data, data, len*cha*sizeof(float));
+    //fill it in
+    atmxSoundFill(snd, data, len, cha);
+    //return
+    return snd;
+}
+ATMXDEF struct atomix_sound* atomixSoundNewPCM (uint8_t cha, const void* data, int32_t len, uint8_t format, uint8_t flags) {
+    //validate arguments first and return NULL if invalid
+    if ((cha < 1)||(cha > 2)||(!data)||(len < 1)||(format < ATOMIX_U8)||(format > ATOMIX_S24)) return NULL;
+    //determine channels to store, comparing converted samples like atmxSoundChannels if asked to collapse stereo
+    uint8_t scha = cha;
+    if ((cha == 2)&&(flags & ATOMIX_MONO)) {
+        float scale = atmxPCMScale(format); int32_t i = 0;
+        while ((i < len)&&(fabsf(atmxPCM(data, format, i*2) - atmxPCM(data, format, i*2 + 1))*scale <= ATOMIX_MONO_TOL)) i++;
+        if (i == len) scha = 1;
+    }
+    //allocate sound, return if that failed
+    struct atomix_sound* snd = atmxSoundAlloc(scha, len, flags);
+    if (!snd) return NULL;
+    //convert data into it
+    atmxSoundConvert(snd, data, len, cha, format);
     //return
     return snd;
 }
+ATMXDEF struct atomix_sound* atomixSoundNewRate (uint8_t cha, float* data, int32_t len, uint8_t flags, uint32_t from, uint32_t to) {
+    //validate arguments first and return NULL if invalid
+    if ((cha < 1)||(cha > 2)||(!data)||(len < 1)||(!from)||(!to)) return NULL;
+    //nothing to resample at the same rate
+    if (from == to) return atomixSoundNewAdv(cha, data, len, flags);
+    //reduce the ratio to L output frames per M input frames, return if the sound would be too long
+    uint32_t a = from, b = to;
+    while (b) { uint32_t t = a % b; a = b; b = t; }
+    uint64_t L = to/a, M = from/a, olen = ((uint64_t)len*L + M - 1)/M;
+    if (olen > INT32_MAX - 3) return NULL;
+    //build the filter first, then allocate sound with the channels to store, return if either failed
+    int32_t taps; float* tab = atmxResampleTable(cha, L, M, &taps);
+    if (!tab) return NULL;
+    struct atomix_sound* snd = atmxSoundAlloc(atmxSoundChannels(cha, data, len, flags), (int32_t)olen, flags);
+    if (snd) atmxResample(snd, data, len, cha, L, M, tab, taps);
+    ATOMIX_FREE(tab);
+    return snd;
+}
+ATMXDEF struct atomix_sound* atomixSoundAlloc (uint8_t cha, int32_t len, uint8_t flags) {
+    //validate arguments first and return NULL if invalid
+    if ((cha < 1)||(cha > 2)||(len < 1)) return NULL;
+    //allocate sound, data stays zero until filled in
+    return atmxSoundAlloc(cha, len, flags);
+}
+ATMXDEF float* atomixSoundData (struct atomix_sound* snd) {
+    //return data as plain floats
+    return (float*)snd->data;
+}
+ATMXDEF int atomixSoundFinish (struct atomix_sound* snd, int32_t len) {
+    //an empty sound has nothing to pad, so zero its length to keep it from playing as silence
+    if (len < 1) { snd->len = 0; return 1; }
+    //shorten to the written frames rounded to a multiple of 4, keeping mipmaps where they were allocated
+    int32_t rlen = (len + 3) & ~0x03;
+    if (rlen > snd->len) len = rlen = snd->len;
+    snd->len = rlen;
+    //pad and generate mipmaps
+    atmxSoundFinish(snd, len);
+    return 0;
+}
 ATMXDEF int32_t atomixSoundLength (struct atomix_sound* snd) {
     //return length, always multiple of 4
     return snd->len;
 }
+ATMXDEF uint8_t atomixSoundChannels (struct atomix_sound* snd) {
+    //return channels as stored
+    return snd->cha;
+}
+ATMXDEF void atomixSoundFree (struct atomix_sound* snd) {
+    //unlock the pages only this sound uses, then free
+    #ifdef ATOMIX_MLOCK
+        atmxUnlock(snd, snd->lock);
+    #endif
+    ATOMIX_FREE(snd);
+}
+ATMXDEF struct atomix_registry* atomixRegistryNew () {
+    //allocate space for the registry filled with zero, which is empty
+    return (struct atomix_registry*)ATOMIX_ZALLOC(sizeof(struct atomix_registry));
+}
+ATMXDEF struct atomix_sound* atomixRegistrySound (struct atomix_registry* reg, uint8_t cha, float* data, int32_t len, uint8_t flags) {
+    //validate arguments first and return NULL if invalid
+    if ((cha < 1)||(cha > 2)||(!data)||(len < 1)) return NULL;
+    //hash content along with channels and flags, and determine channels it would be stored with
+    uint64_t hash = atmxHash(data, (size_t)len*cha) ^ ((uint64_t)cha << 56) ^ ((uint64_t)flags << 48);
+    struct atomix_sound** bkt = &reg->bkt[hash & (ATMX_RBUCKETS - 1)];
+    int32_t rlen = (len + 3) & ~0x03; uint8_t scha = cha;
+    cha = atmxSoundChannels(cha, data, len, flags);
+    //look for a registered sound with the same hash, verifying content in full
+    for (struct atomix_sound* snd = *bkt; snd; snd = snd->next) {
+        if ((snd->hash != hash)||(snd->cha != cha)||(snd->len != rlen)||((!snd->mip[0]) != (!(flags & ATOMIX_MIPMAP)))) continue;
+        if (!atmxSoundSame(snd, data, len, scha)) continue;
+        //found, add a reference and count the copy not made
+        snd->refs++; reg->stats.refs++;
+        reg->stats.saved += atmxSoundBytes(cha, rlen, flags);
+        return snd;
+    }
+    //otherwise create a new sound and register it at the front of the bucket
+    struct atomix_sound* snd = atomixSoundNewAdv(scha, data, len, flags);
+    if (!snd) return NULL;
+    snd->hash = hash; snd->refs = 1; snd->next = *bkt; *bkt = snd;
+    reg->stats.sounds++; reg->stats.refs++;
+    reg->stats.bytes += atmxSoundBytes(cha, rlen, flags);
+    //return
+    return snd;
+}
+ATMXDEF int atomixRegistryRelease (struct atomix_registry* reg, struct atomix_sound* snd) {
+    //return failure if the sound is not registered here
+    struct atomix_sound** link = &reg->bkt[snd->hash & (ATMX_RBUCKETS - 1)];
+    while (*link && (*link != snd)) link = &(*link)->next;
+    if ((!*link)||(!snd->refs)) return -1;
+    //remove a reference, only counting as saved while more than one remains
+    uint8_t flags = snd->mip[0] ? ATOMIX_MIPMAP : 0; reg->stats.refs--;
+    if (--snd->refs) { reg->stats.saved -= atmxSoundBytes(snd->cha, snd->len, flags); return 0; }
+    //unlink the last reference from its bucket
+    *link = snd->next; snd->next = NULL;
+    reg->stats.sounds--; reg->stats.bytes -= atmxSoundBytes(snd->cha, snd->len, flags);
+    //return last reference
+    return 1;
+}
+ATMXDEF void atomixRegistryStats (struct atomix_registry* reg, struct atomix_dedup* stats) {
+    //copy statistics
+    *stats = reg->stats;
+}
 ATMXDEF struct atomix_mixer* atomixMixerNew (float vol, int32_t fade) {
     //allocate space for the mixer filled with zero
     struct atomix_mixer* mix = (struct atomix_mixer*)ATOMIX_ZALLOC(sizeof(struct atomix_mixer));
@@ -246,61 +938,27 @@ ATMXDEF struct atomix_mixer* atomixMixerNew (float vol, int32_t fade) {
     ATMX_STORE(&mix->volume, vol);
     //set fade value
     mix->fade = (fade < 0) ? 0 : fade & ~3;
+    //lock the mixer into memory, faulting it in
+    #ifdef ATOMIX_MLOCK
+        atmxLock(mix, sizeof(struct atomix_mixer), 1);
+    #endif
+    //report creation to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_NEW, 0, 0, NULL, vol, 0.0f, fade, 0, 0, 0.0f, 0.0f, 0.0f);
     //return
     return mix;
 }
-ATMXDEF uint32_t atomixMixerMix (struct atomix_mixer* mix, float* buff, uint32_t fnum) {
-    //the mixing function differs greatly depending on whether SSE is enabled or not
-    #ifndef ATOMIX_NO_SSE
-        //output remaining frames in buffer before mixing new ones
-        uint32_t rnum = fnum;
-        //only do this if there are old frames
-        if (mix->rem)
-            if (rnum > mix->rem) {
-                //rnum bigger than remaining frames (usual case)
-                memcpy(buff, mix->data, mix->rem*2*sizeof(float));
-                rnum -= mix->rem; buff += mix->rem*2; mix->rem = 0;
-            } else {
-                //rnum smaller equal remaining frames (rare case)
-                memcpy(buff, mix->data, rnum*2*sizeof(float)); mix->rem -= rnum;
-                //move back remaining old frames if any
-                if (mix->rem) memmove(mix->data, mix->data + rnum*2, (3 - rnum)*2*sizeof(float));
-                //return
-                return fnum;
-            }
-        //asize in __m128 (__m128 = 2 frames) and multiple of 2
-        uint32_t asize = ((rnum + 3) & ~3) >> 1;
-        //dynamically sized aligned buffer
-        __m128 align[asize];
-        //clear the aligned buffer using SSE assignment
-        for (uint32_t i = 0; i < asize; i++) align[i] = _mm_setzero_ps();
-        //begin actual mixing, caching the volume first
-        __m128 vol = _mm_set_ps1(ATMX_LOAD(&mix->volume));
-        for (int i = 0; i < ATMX_LAYERS; i++) atmxMixLayer(&mix->lays[i], vol, align, asize);
-        //perform clipping using SSE min and max (unless disabled)
-        #ifndef ATOMIX_NO_CLIP
-            __m128 neg1 = _mm_set_ps1(-1.0f), pos1 = _mm_set_ps1(1.0f);
-            for (uint32_t i = 0; i < asize; i++) align[i] = _mm_min_ps(_mm_max_ps(align[i], neg1), pos1);
-        #endif
-        //copy rnum frames, leaving possible remainder
-        memcpy(buff, align, rnum*2*sizeof(float));
-        //determine remaining number of frames
-        mix->rem = asize*2 - rnum;
-        //copy remaining frames to buffer inside the mixer struct
-        if (mix->rem) memcpy(mix->data, (float*)align + rnum*2, mix->rem);
-    #else
-        //clear the output buffer using memset
-        memset(buff, 0, fnum*2*sizeof(float));
-        //begin actual mixing, caching the volume first
-        float vol = ATMX_LOAD(&mix->volume);
-        for (int i = 0; i < ATMX_LAYERS; i++) atmxMixLayer(&mix->lays[i], vol, buff, fnum);
-        //perform clipping using simple ternary operators (unless disabled)
-        #ifndef ATOMIX_NO_CLIP
-            for (uint32_t i = 0; i < fnum*2; i++) buff[i] = (buff[i] < -1.0f) ? -1.0f : (buff[i] > 1.0f) ? 1.0f : buff[i];
-        #endif
+ATMXDEF void atomixMixerFree (struct atomix_mixer* mix) {
+    //unlock the pages only this mixer uses, then free
+    #ifdef ATOMIX_MLOCK
+        atmxUnlock(mix, sizeof(struct atomix_mixer));
     #endif
-    //return
-    return fnum;
+    ATOMIX_FREE(mix);
+}
+ATMXDEF uint32_t atomixMixerMix (struct atomix_mixer* mix, float* buff, uint32_t fnum) {
+    //report frame count to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_MIX, 0, 0, NULL, 0.0f, 0.0f, (int32_t)fnum, 0, 0, 0.0f, 0.0f, 0.0f);
+    //mix
+    return atmxMix(mix, buff, fnum);
 }
 ATMXDEF uint32_t atomixMixerPlay (struct atomix_mixer* mix, struct atomix_sound* snd, uint8_t flag, float gain, float pan) {
     //play with start and end equal to start and end of the sound itself
@@ -319,26 +977,22 @@ ATMXDEF uint32_t atomixMixerPlayAdv (struct atomix_mixer* mix, struct atomix_sou
         if (ATMX_LOAD(&lay->flag) == 0) {
             //skip 0 as it is special
             if (!id) id = ATMX_LAYERS;
-            //fill in non-atomic layer data along with truncating start and end
-            lay->id = id; lay->snd = snd;
-            lay->start = start & ~3; lay->end = end & ~3;
-            lay->fmax = (fade < 0) ? 0 : fade & ~3;
-            //set initial fade state based on flag
-            lay->fade = (flag < 3) ? 0 : lay->fmax;
-            //convert gain and pan to left and right gain and store it atomically
-            ATMX_STORE(&lay->gain, atmxGainf2(gain, pan));
-            //atomically set cursor to start position based on given argument
-            ATMX_STORE(&lay->cursor, lay->start);
-            //store flag last, releasing the layer to the mixer thread
-            ATMX_STORE(&lay->flag, flag);
+            //fill in the layer, releasing it to the mixer thread
+            atmxLayerInit(mix, lay, id, snd, flag, gain, pan, start, end, fade);
+            //report the call along with the new handle
+            ATMX_TRACE(mix, ATOMIX_TRACE_PLAY, flag, id, snd, gain, pan, start, end, fade, 0.0f, 0.0f, 0.0f);
             //return success
             return id;
         }
     }
+    //report the call as failed
+    ATMX_TRACE(mix, ATOMIX_TRACE_PLAY, flag, 0, snd, gain, pan, start, end, fade, 0.0f, 0.0f, 0.0f);
     //return failure
     return 0;
 }
 ATMXDEF int atomixMixerSetGainPan (struct atomix_mixer* mix, uint32_t id, float gain, float pan) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_GAINPAN, 0, id, NULL, gain, pan, 0, 0, 0, 0.0f, 0.0f, 0.0f);
     //get layer based on the lowest bits of id
     struct atmx_layer* lay = &mix->lays[id & ATMX_LMASK];
     //check id and state flag to make sure the id is valid
@@ -352,12 +1006,14 @@ ATMXDEF int atomixMixerSetGainPan (struct atomix_mixer* mix, uint32_t id, float
     return 0;
 }
 ATMXDEF int atomixMixerSetCursor (struct atomix_mixer* mix, uint32_t id, int32_t cursor) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_CURSOR, 0, id, NULL, 0.0f, 0.0f, cursor, 0, 0, 0.0f, 0.0f, 0.0f);
     //get layer based on the lowest bits of id
     struct atmx_layer* lay = &mix->lays[id & ATMX_LMASK];
     //check id and state flag to make sure the id is valid
     if ((id == lay->id)&&(ATMX_LOAD(&lay->flag) > 1)) {
-        //clamp cursor and truncate to multiple of 4 before storing
-        ATMX_STORE(&lay->cursor, (cursor < lay->start) ? lay->start : (cursor > lay->end) ? lay->end : cursor & ~3);
+        //clamp cursor and truncate to multiple of 4 before storing, the end is owned by the mixer so the tail is used
+        ATMX_STORE(&lay->cursor, (cursor < lay->start) ? lay->start : (cursor > lay->tail) ? lay->tail : cursor & ~3);
         //return success
         return 1;
     }
@@ -365,12 +1021,17 @@ ATMXDEF int atomixMixerSetCursor (struct atomix_mixer* mix, uint32_t id, int32_t
     return 0;
 }
 ATMXDEF int atomixMixerSetState (struct atomix_mixer* mix, uint32_t id, uint8_t flag) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_STATE, flag, id, NULL, 0.0f, 0.0f, 0, 0, 0, 0.0f, 0.0f, 0.0f);
     //return failure if given flag invalid
     if ((flag < 1)||(flag > 4)) return 0;
     //get layer based on the lowest bits of id
     struct atmx_layer* lay = &mix->lays[id & ATMX_LMASK]; uint8_t prev;
     //check id and state flag to make sure the id is valid
     if ((id == lay->id)&&((prev = ATMX_LOAD(&lay->flag)) > 1)) {
+        //looping again after a release or running out of loops loops forever, the mixer re-enters the loop
+        int32_t none = 0;
+        if (flag == ATOMIX_LOOP) ATMX_CSWAP(&lay->loops, &none, -1);
         //return success if already in desired state
         if (prev == flag) return 1;
         //swap if flag has not changed and return if successful
@@ -379,15 +1040,225 @@ ATMXDEF int atomixMixerSetState (struct atomix_mixer* mix, uint32_t id, uint8_t
     //return failure
     return 0;
 }
+ATMXDEF int atomixMixerSetDirection (struct atomix_mixer* mix, uint32_t id, float x, float y, float z) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_DIRECTION, 0, id, NULL, 0.0f, 0.0f, 0, 0, 0, x, y, z);
+    //get layer based on the lowest bits of id
+    struct atmx_layer* lay = &mix->lays[id & ATMX_LMASK];
+    //check id and state flag to make sure the id is valid
+    if ((id == lay->id)&&(ATMX_LOAD(&lay->flag) > 1)) {
+        //normalize direction unless zero
+        float len = sqrtf(x*x + y*y + z*z);
+        if (len > 0.0f) { x /= len; y /= len; z /= len; }
+        //store each component atomically, a torn direction is still a valid direction
+        ATMX_STORE(&lay->dir[0], x); ATMX_STORE(&lay->dir[1], y); ATMX_STORE(&lay->dir[2], z);
+        //return success
+        return 1;
+    }
+    //return failure
+    return 0;
+}
+ATMXDEF int atomixMixerSetVelocity (struct atomix_mixer* mix, uint32_t id, float x, float y, float z) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_VELOCITY, 0, id, NULL, 0.0f, 0.0f, 0, 0, 0, x, y, z);
+    //get layer based on the lowest bits of id
+    struct atmx_layer* lay = &mix->lays[id & ATMX_LMASK];
+    //check id and state flag to make sure the id is valid
+    if ((id == lay->id)&&(ATMX_LOAD(&lay->flag) > 1)) {
+        //store each component atomically, a torn velocity only affects a single mix
+        ATMX_STORE(&lay->vel[0], x); ATMX_STORE(&lay->vel[1], y); ATMX_STORE(&lay->vel[2], z);
+        //return success
+        return 1;
+    }
+    //return failure
+    return 0;
+}
+ATMXDEF int atomixMixerSetPitch (struct atomix_mixer* mix, uint32_t id, float pitch) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_PITCH, 0, id, NULL, pitch, 0.0f, 0, 0, 0, 0.0f, 0.0f, 0.0f);
+    //get layer based on the lowest bits of id
+    struct atmx_layer* lay = &mix->lays[id & ATMX_LMASK];
+    //check id and state flag to make sure the id is valid
+    if ((id == lay->id)&&(ATMX_LOAD(&lay->flag) > 1)) {
+        //clamp pitch and store it atomically
+        ATMX_STORE(&lay->pitch, (pitch < 0.25f) ? 0.25f : (pitch > 4.0f) ? 4.0f : pitch);
+        //return success
+        return 1;
+    }
+    //return failure
+    return 0;
+}
+ATMXDEF int atomixMixerSetUnison (struct atomix_mixer* mix, uint32_t id, uint8_t voices, float detune, float spread) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_UNISON, voices, id, NULL, 0.0f, 0.0f, 0, 0, 0, detune, spread, 0.0f);
+    //get layer based on the lowest bits of id
+    struct atmx_layer* lay = &mix->lays[id & ATMX_LMASK];
+    //check id and state flag to make sure the id is valid
+    if ((id == lay->id)&&(ATMX_LOAD(&lay->flag) > 1)) {
+        //clamp and store each parameter atomically, a torn set only affects a single mix
+        ATMX_STORE(&lay->udet, (detune < 0.0f) ? 0.0f : (detune > 0.5f) ? 0.5f : detune);
+        ATMX_STORE(&lay->uspr, (spread < 0.0f) ? 0.0f : (spread > 2.0f) ? 2.0f : spread);
+        ATMX_STORE(&lay->uni, (uint8_t)((voices < 1) ? 1 : (voices > ATMX_UNISON) ? ATMX_UNISON : voices));
+        //return success
+        return 1;
+    }
+    //return failure
+    return 0;
+}
+ATMXDEF int atomixMixerSetGranular (struct atomix_mixer* mix, uint32_t id, int32_t size, int32_t interval, int32_t scatter, float pitch, float spread) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_GRANULAR, 0, id, NULL, 0.0f, 0.0f, size, interval, scatter, pitch, spread, 0.0f);
+    //get layer based on the lowest bits of id
+    struct atmx_layer* lay = &mix->lays[id & ATMX_LMASK];
+    //check id and state flag to make sure the id is valid
+    if ((id == lay->id)&&(ATMX_LOAD(&lay->flag) > 1)) {
+        //clamp and store each parameter atomically, a torn set only affects a single mix
+        ATMX_STORE(&lay->gival, (interval < 1) ? 1 : interval);
+        ATMX_STORE(&lay->gscat, (scatter < 0) ? 0 : scatter);
+        ATMX_STORE(&lay->gpit, (pitch < 0.0f) ? 0.0f : (pitch > 1.0f) ? 1.0f : pitch);
+        ATMX_STORE(&lay->gspr, (spread < 0.0f) ? 0.0f : (spread > 2.0f) ? 2.0f : spread);
+        //size last, as it switches granular rendering on or off
+        ATMX_STORE(&lay->gsize, (size <= 0) ? 0 : (size < 4) ? 4 : size & ~3);
+        //return success
+        return 1;
+    }
+    //return failure
+    return 0;
+}
+ATMXDEF int atomixMixerSetLoops (struct atomix_mixer* mix, uint32_t id, int32_t count) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_LOOPS, 0, id, NULL, 0.0f, 0.0f, count, 0, 0, 0.0f, 0.0f, 0.0f);
+    //get layer based on the lowest bits of id
+    struct atmx_layer* lay = &mix->lays[id & ATMX_LMASK];
+    //check id and state flag to make sure the id is valid
+    if ((id == lay->id)&&(ATMX_LOAD(&lay->flag) > 1)) {
+        //store count atomically, the mixer counts it down
+        ATMX_STORE(&lay->loops, (count < 0) ? -1 : count);
+        //return success
+        return 1;
+    }
+    //return failure
+    return 0;
+}
+ATMXDEF int atomixMixerRelease (struct atomix_mixer* mix, uint32_t id) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_RELEASE, 0, id, NULL, 0.0f, 0.0f, 0, 0, 0, 0.0f, 0.0f, 0.0f);
+    //get layer based on the lowest bits of id
+    struct atmx_layer* lay = &mix->lays[id & ATMX_LMASK];
+    //check id and state flag to make sure the id is valid
+    if ((id == lay->id)&&(ATMX_LOAD(&lay->flag) > 1)) {
+        //no loops left, the mixer leaves the loop when it next reaches its end
+        ATMX_STORE(&lay->loops, 0);
+        //return success
+        return 1;
+    }
+    //return failure
+    return 0;
+}
 ATMXDEF void atomixMixerVolume (struct atomix_mixer* mix, float vol) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_VOLUME, 0, 0, NULL, vol, 0.0f, 0, 0, 0, 0.0f, 0.0f, 0.0f);
     //simple atomic store of the volume
     ATMX_STORE(&mix->volume, vol);
 }
+ATMXDEF void atomixMixerListener (struct atomix_mixer* mix, float yaw, float pitch, float roll) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_LISTENER, 0, 0, NULL, 0.0f, 0.0f, 0, 0, 0, yaw, pitch, roll);
+    //store each angle atomically, any combination of angles is still a valid rotation
+    ATMX_STORE(&mix->lis[0], yaw); ATMX_STORE(&mix->lis[1], pitch); ATMX_STORE(&mix->lis[2], roll);
+}
+ATMXDEF int atomixMixerSetPriority (struct atomix_mixer* mix, uint32_t id, uint8_t prio) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_PRIORITY, prio, id, NULL, 0.0f, 0.0f, 0, 0, 0, 0.0f, 0.0f, 0.0f);
+    //get layer based on the lowest bits of id
+    struct atmx_layer* lay = &mix->lays[id & ATMX_LMASK];
+    //check id and state flag to make sure the id is valid
+    if ((id == lay->id)&&(ATMX_LOAD(&lay->flag) > 1)) {
+        //store priority atomically, the mixer orders layers by it
+        ATMX_STORE(&lay->prio, prio);
+        //return success
+        return 1;
+    }
+    //return failure
+    return 0;
+}
+ATMXDEF void atomixMixerBudget (struct atomix_mixer* mix, uint32_t ticks) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_BUDGET, 0, 0, NULL, 0.0f, 0.0f, (int32_t)ticks, 0, 0, 0.0f, 0.0f, 0.0f);
+    //simple atomic store of the budget
+    ATMX_STORE(&mix->budget, ticks);
+}
+ATMXDEF void atomixMixerStats (struct atomix_mixer* mix, struct atomix_stats* stats, int reset) {
+    //atomically read or exchange each counter
+    uint64_t vals[4];
+    for (int i = 0; i < 4; i++) vals[i] = reset ? atomic_exchange(&mix->stats[i], (uint64_t)0) : ATMX_LOAD(&mix->stats[i]);
+    //fill in stats struct
+    stats->mixes = vals[0]; stats->degraded = vals[1];
+    stats->virtualized = vals[2]; stats->overruns = vals[3];
+}
+ATMXDEF int atomixMixerCalibrate (struct atomix_mixer* mix) {
+    //allocate scratch mixer and mono and stereo noise to mix, return failure if any zalloc failed
+    struct atomix_mixer* tmp = (struct atomix_mixer*)ATOMIX_ZALLOC(sizeof(struct atomix_mixer));
+    struct atomix_sound* mono = atmxSoundAlloc(1, 32768, 0);
+    struct atomix_sound* stereo = atmxSoundAlloc(2, 32768, 0);
+    int ok = (tmp && mono && stereo);
+    if (ok) {
+        uint32_t seed = 1;
+        float* data = (float*)mono->data;
+        for (int32_t i = 0; i < 32768; i++) data[i] = (float)(int32_t)(seed = seed*1664525u + 1013904223u)*(1.0f/4294967296.0f);
+        data = (float*)stereo->data;
+        for (int32_t i = 0; i < 65536; i++) data[i] = (float)(int32_t)(seed = seed*1664525u + 1013904223u)*(1.0f/4294967296.0f);
+        atmxSoundFinish(mono, 32768); atmxSoundFinish(stereo, 32768);
+        ATMX_STORE(&tmp->volume, 1.0f);
+        //fastest of a few rounds over all runs, so that a core changing its clock mid-way affects all of them alike
+        float t[9];
+        for (int r = 0; r < 3; r++)
+            for (int i = 0; i < 9; i++) {
+                float c = atmxCalibrate(tmp, (i == 1)||(i == 6)||(i == 7) ? stereo : mono, i);
+                if ((!r)||(c < t[i])) t[i] = c;
+            }
+        //the mix itself, then the cost of each path per layer and frame on top of it
+        for (int i = 0; i < 8; i++) t[i] = (t[i] > t[8]) ? (t[i] - t[8])/(8.0f*1024.0f) : 0.0f;
+        for (int i = 0; i < 4; i++) mix->cost[i] = t[i];
+        //unison with 2 and 8 voices and granular with 4 and 16 grains split into a part per layer and per voices or grain
+        float w2 = (float)atmxUnisonWidth(2), w8 = (float)atmxUnisonWidth(8);
+        float voice = (t[5] > t[4]) ? (t[5] - t[4])/(w8 - w2) : 0.0f, grain = (t[7] > t[6]) ? (t[7] - t[6])/12.0f : 0.0f;
+        mix->cost[4] = (t[4] > w2*voice) ? t[4] - w2*voice : 0.0f; mix->cost[5] = voice;
+        mix->cost[6] = (t[6] > 4.0f*grain) ? t[6] - 4.0f*grain : 0.0f; mix->cost[7] = grain;
+        mix->cost[8] = t[8]/1024.0f;
+    }
+    //free scratch mixer and sounds
+    ATOMIX_FREE(tmp);
+    if (mono) atomixSoundFree(mono);
+    if (stereo) atomixSoundFree(stereo);
+    //return
+    return ok;
+}
+ATMXDEF uint64_t atomixMixerEstimate (struct atomix_mixer* mix, uint32_t fnum, struct atomix_sound* snd) {
+    //start with the mix itself, which is 0 if not calibrated
+    float cost = mix->cost[8];
+    //add the path each active layer takes
+    for (int i = 0; i < ATMX_LAYERS; i++) cost += atmxLayerCost(mix, &mix->lays[i]);
+    //add another plain voice of given sound
+    if (snd) cost += mix->cost[(snd->cha == 1) ? 0 : 1];
+    //return
+    return (uint64_t)(cost*(float)fnum);
+}
+ATMXDEF void atomixMixerBinaural (struct atomix_mixer* mix, int32_t rate) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_BINAURAL, 0, 0, NULL, 0.0f, 0.0f, rate, 0, 0, 0.0f, 0.0f, 0.0f);
+    //simple atomic store of the sample rate
+    ATMX_STORE(&mix->brate, (rate < 0) ? 0 : rate);
+}
 ATMXDEF void atomixMixerFade (struct atomix_mixer* mix, int32_t fade) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_FADE, 0, 0, NULL, 0.0f, 0.0f, fade, 0, 0, 0.0f, 0.0f, 0.0f);
     //simple assignment of the fade value
     mix->fade = (fade < 0) ? 0 : fade & ~3;
 }
 ATMXDEF void atomixMixerStopAll (struct atomix_mixer* mix) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_STOPALL, 0, 0, NULL, 0.0f, 0.0f, 0, 0, 0, 0.0f, 0.0f, 0.0f);
     //go through all active layers and set their states to the stop state
     for (int i = 0; i < ATMX_LAYERS; i++) {
         //pointer to this layer for cleaner code
@@ -397,6 +1268,8 @@ ATMXDEF void atomixMixerStopAll (struct atomix_mixer* mix) {
     }
 }
 ATMXDEF void atomixMixerHaltAll (struct atomix_mixer* mix) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_HALTALL, 0, 0, NULL, 0.0f, 0.0f, 0, 0, 0, 0.0f, 0.0f, 0.0f);
     //go through all playing layers and set their states to halt
     for (int i = 0; i < ATMX_LAYERS; i++) {
         //pointer to this layer for cleaner code
@@ -406,6 +1279,8 @@ ATMXDEF void atomixMixerHaltAll (struct atomix_mixer* mix) {
     }
 }
 ATMXDEF void atomixMixerPlayAll (struct atomix_mixer* mix) {
+    //report the call to the trace hook
+    ATMX_TRACE(mix, ATOMIX_TRACE_PLAYALL, 0, 0, NULL, 0.0f, 0.0f, 0, 0, 0, 0.0f, 0.0f, 0.0f);
     //go through all halted layers and set their states to play
     for (int i = 0; i < ATMX_LAYERS; i++) {
         //need to reset each time
@@ -414,38 +1289,220 @@ ATMXDEF void atomixMixerPlayAll (struct atomix_mixer* mix) {
         ATMX_CSWAP(&mix->lays[i].flag, &flag, (uint8_t)ATOMIX_PLAY);
     }
 }
-
-//internal functions
-#ifndef ATOMIX_NO_SSE
-static void atmxMixLayer (struct atmx_layer* lay, __m128 vol, __m128* align, uint32_t asize) {
-    //load flag value atomically first
-    uint8_t flag = ATMX_LOAD(&lay->flag);
-    //return if flag cleared
-    if (flag == 0) return;
-    //atomically load cursor
-    int32_t cur = ATMX_LOAD(&lay->cursor);
-    //atomically load left and right gain
-    struct atmx_f2 g = ATMX_LOAD(&lay->gain);
-    __m128 gmul = _mm_mul_ps(_mm_setr_ps(g.l, g.r, g.l, g.r), vol);
-    //action based on flag
-    if (flag < 3) {
-        //ATOMIX_STOP or ATOMIX_HALT, fade out if not faded or at end
-        if ((lay->fade > 0)&&(cur < lay->end)) 
-            if (lay->snd->cha == 1)
-                cur = atmxMixFadeMono(lay, cur, gmul, align, asize);
-            else
+#ifdef ATOMIX_PROFILE
+ATMXDEF void atomixSoundProfile (struct atomix_sound* snd, struct atomix_profile* prof, int reset) {
+    //atomically read or exchange each counter
+    uint64_t vals[4];
+    for (int i = 0; i < 4; i++) vals[i] = reset ? atomic_exchange(&snd->prof[i], (uint64_t)0) : ATMX_LOAD(&snd->prof[i]);
+    //fill in profile struct
+    prof->cycles = vals[0]; prof->calls = vals[1];
+    prof->fades = vals[2]; prof->wraps = vals[3];
+}
+#endif
+#ifdef ATOMIX_SHM
+ATMXDEF struct atomix_bank* atomixBankCreate (const char* name, size_t size) {
+    //validate arguments first and return NULL if invalid
+    if ((!name)||(strlen(name) >= 256)||(size < sizeof(struct atmx_bankhead))) return NULL;
+    //remove any previous bank of that name, which lives on for processes still attached to it
+    //then create the named shared memory anew, which is zero filled, and map it writable
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT|O_EXCL|O_RDWR, 0644);
+    if (fd < 0) return NULL;
+    void* base = (ftruncate(fd, (off_t)size) == 0) ? mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (base == MAP_FAILED) { shm_unlink(name); return NULL; }
+    //allocate bank struct, undoing everything if zalloc failed
+    struct atomix_bank* bank = (struct atomix_bank*)ATOMIX_ZALLOC(sizeof(struct atomix_bank));
+    if (!bank) { munmap(base, size); shm_unlink(name); return NULL; }
+    bank->base = (unsigned char*)base; bank->size = size; bank->write = 1; strcpy(bank->name, name);
+    bank->off = sizeof(struct atmx_bankhead);
+    #ifdef ATOMIX_MLOCK
+        atmxLock(base, size, 1);
+    #endif
+    //initialize header, with the magic number last
+    struct atmx_bankhead* head = (struct atmx_bankhead*)base;
+    head->used = sizeof(struct atmx_bankhead); ATMX_STORE(&head->count, 0);
+    head->magic = ATMX_BMAGIC;
+    //return
+    return bank;
+}
+ATMXDEF struct atomix_bank* atomixBankAttach (const char* name) {
+    //validate arguments first and return NULL if invalid
+    if ((!name)||(strlen(name) >= 256)) return NULL;
+    //open the named shared memory and map all of it read-only
+    int fd = shm_open(name, O_RDONLY, 0); struct stat st;
+    if (fd < 0) return NULL;
+    void* base = ((fstat(fd, &st) == 0)&&((size_t)st.st_size >= sizeof(struct atmx_bankhead))) ?
+        mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+    //check that this is an initialized bank
+    if (((struct atmx_bankhead*)base)->magic != ATMX_BMAGIC) { munmap(base, (size_t)st.st_size); return NULL; }
+    //allocate bank struct, unmapping if zalloc failed
+    struct atomix_bank* bank = (struct atomix_bank*)ATOMIX_ZALLOC(sizeof(struct atomix_bank));
+    if (!bank) { munmap(base, (size_t)st.st_size); return NULL; }
+    bank->base = (unsigned char*)base; bank->size = (size_t)st.st_size; strcpy(bank->name, name);
+    bank->off = sizeof(struct atmx_bankhead);
+    #ifdef ATOMIX_MLOCK
+        atmxLock(base, bank->size, 0);
+    #endif
+    //return
+    return bank;
+}
+ATMXDEF struct atomix_sound* atomixBankAdd (struct atomix_bank* bank, uint8_t cha, float* data, int32_t len, uint8_t flags) {
+    //validate arguments first and return NULL if invalid or not writable
+    if ((!bank->write)||(cha < 1)||(cha > 2)||(!data)||(len < 1)) return NULL;
+    //determine channels to store, round length to next multiple of 4 and the record to a multiple of 16 bytes
+    uint8_t scha = cha; cha = atmxSoundChannels(cha, data, len, flags);
+    struct atmx_bankhead* head = (struct atmx_bankhead*)bank->base;
+    int32_t rlen = (len + 3) & ~0x03; size_t bytes = sizeof(struct atmx_bankrec) + ((atmxSoundBytes(cha, rlen, flags) + 15) & ~15);
+    if (head->used + bytes > bank->size) return NULL;
+    //allocate sound struct only, return if zalloc failed
+    struct atomix_sound* snd = (struct atomix_sound*)ATOMIX_ZALLOC(sizeof(struct atomix_sound));
+    if (!snd) return NULL;
+    #ifdef ATOMIX_MLOCK
+        atmxLock(snd, snd->lock = sizeof(struct atomix_sound), 1);
+    #endif
+    //write record and data into the bank
+    struct atmx_bankrec* rec = (struct atmx_bankrec*)(void*)(bank->base + head->used);
+    rec->cha = cha; rec->len = rlen; rec->flags = flags;
+    atmxSoundInit(snd, cha, rlen, flags, &rec[1]);
+    atmxSoundFill(snd, data, len, scha);
+    //publish the sound to other processes once complete
+    head->used += bytes;
+    ATMX_STORE(&head->count, ATMX_LOAD(&head->count) + 1);
+    //return
+    return snd;
+}
+ATMXDEF struct atomix_sound* atomixBankSound (struct atomix_bank* bank, int32_t index) {
+    //return NULL if index out of range
+    if ((index < 0)||(index >= atomixBankCount(bank))) return NULL;
+    //walk the records up to the one with given index, from the one last looked up unless past it
+    if (index < bank->idx) { bank->idx = 0; bank->off = sizeof(struct atmx_bankhead); }
+    struct atmx_bankrec rec; size_t bytes;
+    for (; bank->idx < index; bank->idx++, bank->off += bytes)
+        if (!(bytes = atmxBankRecord(bank, bank->off, &rec))) return NULL;
+    //return NULL if the record itself is malformed or overruns the mapping
+    if (!atmxBankRecord(bank, bank->off, &rec)) return NULL;
+    //allocate sound struct only, return if zalloc failed
+    struct atomix_sound* snd = (struct atomix_sound*)ATOMIX_ZALLOC(sizeof(struct atomix_sound));
+    if (!snd) return NULL;
+    #ifdef ATOMIX_MLOCK
+        atmxLock(snd, snd->lock = sizeof(struct atomix_sound), 1);
+    #endif
+    //point it at the shared data without copying
+    atmxSoundInit(snd, (uint8_t)rec.cha, rec.len, (uint8_t)rec.flags, bank->base + bank->off + sizeof(struct atmx_bankrec));
+    //return
+    return snd;
+}
+ATMXDEF int32_t atomixBankCount (struct atomix_bank* bank) {
+    //atomic load as the creating process may still be adding sounds
+    return ATMX_LOAD(&((struct atmx_bankhead*)bank->base)->count);
+}
+ATMXDEF void atomixBankClose (struct atomix_bank* bank, int unlink) {
+    //unmap and optionally remove the name, the memory lives on until unmapped by every process
+    munmap(bank->base, bank->size);
+    if (unlink) shm_unlink(bank->name);
+    bank->base = NULL; bank->size = 0;
+}
+#endif
+#ifdef ATOMIX_MLOCK
+ATMXDEF int atomixThreadRealtime (int prio) {
+    //fault in the stack that mixing will use, volatile so the writes are kept
+    volatile unsigned char stack[ATMX_STACK], *p = stack;
+    for (size_t i = 0; i < ATMX_STACK; i += 1024) p[i] = 0;
+    //clamp priority to the range of SCHED_FIFO and apply it to the calling thread
+    int lo = sched_get_priority_min(SCHED_FIFO), hi = sched_get_priority_max(SCHED_FIFO);
+    struct sched_param sp; memset(&sp, 0, sizeof(sp));
+    sp.sched_priority = (prio < lo) ? lo : (prio > hi) ? hi : prio;
+    //return
+    return (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp) == 0);
+}
+#endif
+
+//internal functions
+#ifndef ATOMIX_NO_SSE
+static void atmxMixLayer (struct atomix_mixer* mix, struct atmx_layer* lay, __m128 vol, __m128* align, uint32_t asize, int virt) {
+    //load flag value atomically first
+    uint8_t flag = ATMX_LOAD(&lay->flag);
+    //return if flag cleared
+    if (flag == 0) return;
+    //atomically load cursor
+    int32_t cur = ATMX_LOAD(&lay->cursor);
+    //atomically load left and right gain, replacing the pan if positional
+    float dot = 0.0f; int pos = atmxDirection(mix, lay, &dot);
+    struct atmx_f2 g = ATMX_LOAD(&lay->gain);
+    if (pos) g = atmxGainf2(g.l + g.r, -dot);
+    //atomically load grain size, state is stale unless granular
+    int gra = (ATMX_LOAD(&lay->gsize) > 0);
+    if (!gra) lay->gran.on = 0;
+    //atomically load unison voices, state is stale unless more than one and not granular
+    int uni = ATMX_LOAD(&lay->uni);
+    if ((uni < 2)||gra) { uni = 0; lay->unis.on = 0; }
+    //positional sounds are rendered binaurally instead if enabled and neither, state is stale otherwise
+    int bin = pos&&(mix->bk > 0.0f)&&(!uni)&&(!gra);
+    if (!bin) lay->bin.on = 0;
+    //load playback rate of this mix, the fractional cursor only matters while pitched, unison, or granular
+    float rate = lay->trate; int pit = atmxPitched(lay, rate);
+    if ((!pit)&&(!uni)&&(!gra)) lay->frac = 0.0f;
+    __m128 gmul = _mm_mul_ps(_mm_setr_ps(g.l, g.r, g.l, g.r), vol);
+    struct atmx_f2 gvol = {g.l*_mm_cvtss_f32(vol), g.r*_mm_cvtss_f32(vol)};
+    #ifdef ATOMIX_PROFILE
+        //remember sound, clock, cursor, and whether fading for profiling
+        struct atomix_sound* psnd = lay->snd; uint64_t pclk = ATOMIX_CLOCK(); int32_t pcur = cur;
+        int pfade = (flag < 3) ? (lay->fade > 0) : (lay->fade < lay->fmax);
+    #endif
+    //action based on flag
+    if (flag < 3) {
+        //ATOMIX_STOP or ATOMIX_HALT, fade out if not faded or at end
+        if ((lay->fade > 0)&&(cur < lay->end)) 
+            if (virt)
+                cur = atmxMixSkip(lay, flag, cur, rate, asize*2, 4);
+            else if (gra)
+                cur = atmxMixGranular(lay, flag, cur, rate, gvol, align, asize);
+            else if (uni)
+                cur = atmxMixUnison(lay, flag, cur, rate, uni, gvol, align, asize);
+            else if (bin)
+                cur = atmxMixBinaural(mix, lay, flag, cur, dot, rate, (g.l + g.r)*_mm_cvtss_f32(vol), align, asize);
+            else if (pit)
+                cur = atmxMixPitch(lay, flag, cur, rate, gmul, align, asize);
+            else if (lay->snd->cha == 1)
+                cur = atmxMixFadeMono(lay, cur, gmul, align, asize);
+            else
                 cur = atmxMixFadeStereo(lay, cur, gmul, align, asize);
         //clear flag if ATOMIX_STOP and fully faded or at end
-        if ((flag == ATOMIX_STOP)&&((lay->fade == 0)||(cur == lay->end))) ATMX_STORE(&lay->flag, (uint8_t)0);
+        if ((flag == ATOMIX_STOP)&&((lay->fade == 0)||(cur >= lay->end))) ATMX_STORE(&lay->flag, (uint8_t)0);
     } else {
-        //ATOMIX_PLAY or ATOMIX_LOOP, play including fade in
-        if (lay->snd->cha == 1)
+        //ATOMIX_PLAY or ATOMIX_LOOP, play including fade in, re-entering a loop left before if looping again
+        if ((flag == ATOMIX_LOOP)&&(lay->end != lay->lend)&&ATMX_LOAD(&lay->loops)) lay->end = lay->lend;
+        if (virt)
+            cur = atmxMixSkip(lay, flag, cur, rate, asize*2, 4);
+        else if (gra)
+            cur = atmxMixGranular(lay, flag, cur, rate, gvol, align, asize);
+        else if (uni)
+            cur = atmxMixUnison(lay, flag, cur, rate, uni, gvol, align, asize);
+        else if (bin)
+            cur = atmxMixBinaural(mix, lay, flag, cur, dot, rate, (g.l + g.r)*_mm_cvtss_f32(vol), align, asize);
+        else if (pit)
+            cur = atmxMixPitch(lay, flag, cur, rate, gmul, align, asize);
+        else if ((lay->snd->cha == 1)&&atmxMixBatchable(lay, cur, asize))
+            cur = atmxMixQueue(mix, lay, cur, gvol, align, asize);
+        else if (lay->snd->cha == 1)
             cur = atmxMixPlayMono(lay, (flag == ATOMIX_LOOP), cur, gmul, align, asize);
         else
             cur = atmxMixPlayStereo(lay, (flag == ATOMIX_LOOP), cur, gmul, align, asize);
         //clear flag if ATOMIX_PLAY and the cursor has reached the end
-        if ((flag == ATOMIX_PLAY)&&(cur == lay->end)) ATMX_CSWAP(&lay->flag, &flag, (uint8_t)0);
+        if ((flag == ATOMIX_PLAY)&&(cur >= lay->end)) ATMX_CSWAP(&lay->flag, &flag, (uint8_t)0);
+        //switch to ATOMIX_PLAY once out of loops and past the loop, or with no tail to move on to
+        if ((flag == ATOMIX_LOOP)&&(lay->end == lay->tail)&&(ATMX_LOAD(&lay->loops) == 0))
+            ATMX_CSWAP(&lay->flag, &flag, (uint8_t)ATOMIX_PLAY);
     }
+    //land exactly on the target rate, as stepping towards it frame by frame accumulates rounding error
+    lay->rate = rate;
+    #ifdef ATOMIX_PROFILE
+        //attribute elapsed cycles and path taken to the sound
+        atmxProfile(psnd, ATOMIX_CLOCK() - pclk, pfade, (flag == ATOMIX_LOOP)&&(cur < pcur));
+    #endif
 }
 static int32_t atmxMixFadeMono (struct atmx_layer* lay, int32_t cur, __m128 gmul, __m128* align, uint32_t asize) {
     //cache cursor
@@ -474,7 +1531,7 @@ static int32_t atmxMixFadeMono (struct atmx_layer* lay, int32_t cur, __m128 gmul
         //continue playback to end without fade out
         for (uint32_t i = 0; i < asize; i += 2) {
             //quit if cursor at end
-            if (cur == lay->end) break;
+            if (cur >= lay->end) break;
             //mix if cursor within sound
             if (cur >= 0) {
                 //load 4 samples from data (this is 4 frames)
@@ -520,7 +1577,7 @@ static int32_t atmxMixFadeStereo (struct atmx_layer* lay, int32_t cur, __m128 gm
         //continue playback to end without fade out
         for (uint32_t i = 0; i < asize; i += 2) {
             //quit if cursor at end
-            if (cur == lay->end) break;
+            if (cur >= lay->end) break;
             //mix if cursor within sound
             if (cur >= 0) {
                 //mod for repeating and convert to __m128 offset
@@ -547,11 +1604,9 @@ static int32_t atmxMixPlayMono (struct atmx_layer* lay, int loop, int32_t cur, _
         //perform fade in
         for (uint32_t i = 0; i < asize; i += 2) {
             //check if cursor at end
-            if (cur == lay->end) {
-                //quit unless looping
-                if (!loop) break;
-                //wrap around if looping
-                cur = lay->start;
+            if (cur >= lay->end) {
+                //quit unless looping, wrapping around or moving on past a loop that ran out otherwise
+                if (!atmxMixLoop(lay, &loop, &cur)) break;
             }
             //mix if cursor within sound
             if (cur >= 0) {
@@ -573,11 +1628,9 @@ static int32_t atmxMixPlayMono (struct atmx_layer* lay, int loop, int32_t cur, _
         //regular playback
         for (uint32_t i = 0; i < asize; i += 2) {
             //check if cursor at end
-            if (cur == lay->end) {
-                //quit unless looping
-                if (!loop) break;
-                //wrap around if looping
-                cur = lay->start;
+            if (cur >= lay->end) {
+                //quit unless looping, wrapping around or moving on past a loop that ran out otherwise
+                if (!atmxMixLoop(lay, &loop, &cur)) break;
             }
             //mix if cursor within sound
             if (cur >= 0) {
@@ -597,6 +1650,52 @@ static int32_t atmxMixPlayMono (struct atmx_layer* lay, int loop, int32_t cur, _
     //return new cursor
     return cur;
 }
+static int atmxMixBatchable (struct atmx_layer* lay, int32_t cur, uint32_t asize) {
+    //profiling attributes cost per layer, which queued voices would not have yet
+    #ifdef ATOMIX_PROFILE
+        (void)lay; (void)cur; (void)asize;
+        return 0;
+    #else
+        //fully faded in and playing data of the sound throughout without wrapping or reaching the end
+        //the end is excluded so the layer stays active until its voice is mixed later in this mix
+        int32_t next = cur + (int32_t)asize*2;
+        return (lay->fade >= lay->fmax)&&(cur >= 0)&&(next < lay->end)&&(next <= lay->snd->len);
+    #endif
+}
+static int32_t atmxMixQueue (struct atomix_mixer* mix, struct atmx_layer* lay, int32_t cur, struct atmx_f2 g, __m128* align, uint32_t asize) {
+    //cache cursor
+    int32_t old = cur;
+    //queue voice with its gains, mixing once 4 are queued
+    struct atmx_batch* b = &mix->batch;
+    b->src[b->num] = &lay->snd->data[cur >> 2]; b->gl[b->num] = g.l; b->gr[b->num] = g.r;
+    if (++b->num == 4) atmxMixBatch(b, align, asize);
+    //advance cursor by the whole buffer, which is known to fit
+    cur += (int32_t)asize*2;
+    //swap back cursor if unchanged
+    if (!ATMX_CSWAP(&lay->cursor, &old, cur)) cur = old;
+    //return new cursor
+    return cur;
+}
+static void atmxMixBatch (struct atmx_batch* b, __m128* align, uint32_t asize) {
+    //unused voices read the first voice silently
+    for (int k = b->num; k < 4; k++) { b->src[k] = b->src[0]; b->gl[k] = b->gr[k] = 0.0f; }
+    __m128 *s0 = b->src[0], *s1 = b->src[1], *s2 = b->src[2], *s3 = b->src[3];
+    __m128 l0 = _mm_set_ps1(b->gl[0]), l1 = _mm_set_ps1(b->gl[1]), l2 = _mm_set_ps1(b->gl[2]), l3 = _mm_set_ps1(b->gl[3]);
+    __m128 r0 = _mm_set_ps1(b->gr[0]), r1 = _mm_set_ps1(b->gr[1]), r2 = _mm_set_ps1(b->gr[2]), r3 = _mm_set_ps1(b->gr[3]);
+    for (uint32_t i = 0, j = 0; i < asize; i += 2, j++) {
+        //load 4 samples from each voice (this is 4 frames of 4 voices)
+        __m128 a = s0[j], b1 = s1[j], c = s2[j], d = s3[j];
+        //sum voices into planar left and right with their own gains
+        __m128 l = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, l0), _mm_mul_ps(b1, l1)), _mm_add_ps(_mm_mul_ps(c, l2), _mm_mul_ps(d, l3)));
+        __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, r0), _mm_mul_ps(b1, r1)), _mm_add_ps(_mm_mul_ps(c, r2), _mm_mul_ps(d, r3)));
+        //mix low frames interleaved with unpacklo
+        align[i] = _mm_add_ps(align[i], _mm_unpacklo_ps(l, r));
+        //mix high frames interleaved with unpackhi
+        align[i+1] = _mm_add_ps(align[i+1], _mm_unpackhi_ps(l, r));
+    }
+    //queue is empty again
+    b->num = 0;
+}
 static int32_t atmxMixPlayStereo (struct atmx_layer* lay, int loop, int32_t cur, __m128 gmul, __m128* align, uint32_t asize) {
     //cache cursor
     int32_t old = cur;
@@ -605,11 +1704,9 @@ static int32_t atmxMixPlayStereo (struct atmx_layer* lay, int loop, int32_t cur,
         //perform fade in
         for (uint32_t i = 0; i < asize; i += 2) {
             //check if cursor at end
-            if (cur == lay->end) {
-                //quit unless looping
-                if (!loop) break;
-                //wrap around if looping
-                cur = lay->start;
+            if (cur >= lay->end) {
+                //quit unless looping, wrapping around or moving on past a loop that ran out otherwise
+                if (!atmxMixLoop(lay, &loop, &cur)) break;
             }
             //mix if cursor within sound
             if (cur >= 0) {
@@ -631,11 +1728,9 @@ static int32_t atmxMixPlayStereo (struct atmx_layer* lay, int loop, int32_t cur,
         //regular playback
         for (uint32_t i = 0; i < asize; i += 2) {
             //check if cursor at end
-            if (cur == lay->end) {
-                //quit unless looping
-                if (!loop) break;
-                //wrap around if looping
-                cur = lay->start;
+            if (cur >= lay->end) {
+                //quit unless looping, wrapping around or moving on past a loop that ran out otherwise
+                if (!atmxMixLoop(lay, &loop, &cur)) break;
             }
             //mix if cursor within sound
             if (cur >= 0) {
@@ -655,37 +1750,353 @@ static int32_t atmxMixPlayStereo (struct atmx_layer* lay, int loop, int32_t cur,
     //return new cursor
     return cur;
 }
+static int32_t atmxMixBinaural (struct atomix_mixer* mix, struct atmx_layer* lay, uint8_t flag, int32_t cur, float dot, float rate, float gain, __m128* align, uint32_t asize) {
+    //cache cursor and determine what to do with it
+    int32_t old = cur; int mode = atmxMixMode(lay, flag, cur, rate), loop = (flag == ATOMIX_LOOP);
+    //determine whether to read at a fractional cursor, how to ramp the rate, and which mipmap level to read
+    int pit = atmxPitched(lay, rate); float step = atmxMixRate(lay, rate, (float)(asize*2));
+    int lev = atmxMixLevel(lay->snd, rate);
+    struct atmx_binaural* bin = &lay->bin;
+    //compute target parameters, snapping to them with cleared state if not current
+    float del[2], b0[2], b1[2];
+    atmxBinauralTarget(mix, dot, del, b0, b1);
+    if (!bin->on) {
+        memset(bin, 0, sizeof(struct atmx_binaural)); bin->on = 1;
+        memcpy(bin->del, del, sizeof(del)); memcpy(bin->b0, b0, sizeof(b0)); memcpy(bin->b1, b1, sizeof(b1));
+    }
+    //per frame steps that reach the targets at the end of this mix
+    float n = (float)(asize*2), ds[2] = {(del[0] - bin->del[0])/n, (del[1] - bin->del[1])/n};
+    //filter coefficients, steps and state with left ear in the first lane and right ear in the second
+    __m128 b0v = _mm_setr_ps(bin->b0[0], bin->b0[1], 0.0f, 0.0f), b1v = _mm_setr_ps(bin->b1[0], bin->b1[1], 0.0f, 0.0f);
+    __m128 d0v = _mm_setr_ps((b0[0] - bin->b0[0])/n, (b0[1] - bin->b0[1])/n, 0.0f, 0.0f);
+    __m128 d1v = _mm_setr_ps((b1[0] - bin->b1[0])/n, (b1[1] - bin->b1[1])/n, 0.0f, 0.0f);
+    __m128 x1 = _mm_setr_ps(bin->x1[0], bin->x1[1], 0.0f, 0.0f), y1 = _mm_setr_ps(bin->y1[0], bin->y1[1], 0.0f, 0.0f);
+    //half the gain so a sound straight ahead matches the centre of the pan law
+    __m128 a1 = _mm_set_ps1(mix->ba1), gmul = _mm_set_ps1(gain*0.5f);
+    for (uint32_t i = 0; i < asize; i += 2) {
+        //quit if faded out or at end, wrapping around if looping
+        float f = atmxMixBegin(lay, mode, &loop, &cur);
+        if (f < 0.0f) break;
+        //load 4 mono frames with fade applied, interpolated if pitched, silence before the start of the sound
+        float sam[4] = {0.0f, 0.0f, 0.0f, 0.0f}; int32_t adv = 4;
+        if (pit) {
+            __m128 l, r; adv = atmxMixRead4(lay->snd, lev, cur, &lay->frac, &lay->rate, step, &l, &r);
+            _mm_storeu_ps(sam, _mm_mul_ps(_mm_add_ps(l, r), _mm_set_ps1(0.5f*f)));
+        } else if (cur >= 0) _mm_storeu_ps(sam, _mm_mul_ps(atmxMixMono4(lay->snd, cur), _mm_set_ps1(f)));
+        //run each frame through the delay line and filter
+        __m128 y[4];
+        for (int k = 0; k < 4; k++) {
+            //write frame then read both ears with linear interpolation
+            bin->hist[bin->w & (ATMX_BHIST - 1)] = sam[k];
+            float ear[2];
+            for (int j = 0; j < 2; j++) {
+                bin->del[j] += ds[j];
+                float pos = (float)((bin->w & (ATMX_BHIST - 1)) + ATMX_BHIST) - bin->del[j];
+                int32_t ipos = (int32_t)pos; float frac = pos - (float)ipos;
+                ear[j] = bin->hist[ipos & (ATMX_BHIST - 1)]*(1.0f - frac) + bin->hist[(ipos + 1) & (ATMX_BHIST - 1)]*frac;
+            }
+            bin->w++;
+            //first-order head shadow filter on both ears at once
+            __m128 x = _mm_setr_ps(ear[0], ear[1], 0.0f, 0.0f);
+            b0v = _mm_add_ps(b0v, d0v); b1v = _mm_add_ps(b1v, d1v);
+            y1 = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(b0v, x), _mm_mul_ps(b1v, x1)), _mm_mul_ps(a1, y1));
+            x1 = x; y[k] = y1;
+        }
+        //mix in first two frames
+        align[i] = _mm_add_ps(align[i], _mm_mul_ps(_mm_movelh_ps(y[0], y[1]), gmul));
+        //mix in second two frames
+        align[i+1] = _mm_add_ps(align[i+1], _mm_mul_ps(_mm_movelh_ps(y[2], y[3]), gmul));
+        //advance fade and cursor
+        atmxMixAdvance(lay, mode, &cur, 4, adv);
+    }
+    //store filter coefficients and state
+    float st[4];
+    _mm_storeu_ps(st, b0v); bin->b0[0] = st[0]; bin->b0[1] = st[1];
+    _mm_storeu_ps(st, b1v); bin->b1[0] = st[0]; bin->b1[1] = st[1];
+    _mm_storeu_ps(st, x1); bin->x1[0] = st[0]; bin->x1[1] = st[1];
+    _mm_storeu_ps(st, y1); bin->y1[0] = st[0]; bin->y1[1] = st[1];
+    //never leave the cursor past the end, so that regular kernels can take over
+    atmxMixWrap(lay, mode, &loop, &cur);
+    //swap back cursor if unchanged
+    if (!ATMX_CSWAP(&lay->cursor, &old, cur)) cur = old;
+    //return new cursor
+    return cur;
+}
+static __m128 atmxMixMono4 (struct atomix_sound* snd, int32_t cur) {
+    //load 4 samples from data if already mono (this is 4 frames)
+    if (snd->cha == 1) return snd->data[(cur % snd->len) >> 2];
+    //otherwise deinterleave 4 stereo frames and average left and right
+    int32_t off = (cur % snd->len) >> 1;
+    __m128 a = snd->data[off], b = snd->data[off+1];
+    __m128 l = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)), r = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+    return _mm_mul_ps(_mm_add_ps(l, r), _mm_set_ps1(0.5f));
+}
+static int32_t atmxMixPitch (struct atmx_layer* lay, uint8_t flag, int32_t cur, float rate, __m128 gmul, __m128* align, uint32_t asize) {
+    //cache cursor and determine what to do with it
+    int32_t old = cur; int mode = atmxMixMode(lay, flag, cur, rate), loop = (flag == ATOMIX_LOOP);
+    //per frame step that reaches the target rate at the end of this mix, and mipmap level to read
+    float step = atmxMixRate(lay, rate, (float)(asize*2)); int lev = atmxMixLevel(lay->snd, rate);
+    for (uint32_t i = 0; i < asize; i += 2) {
+        //quit if faded out or at end, wrapping around if looping
+        float f = atmxMixBegin(lay, mode, &loop, &cur);
+        if (f < 0.0f) break;
+        //read 4 interpolated frames as separate left and right samples
+        __m128 l, r; int32_t adv = atmxMixRead4(lay->snd, lev, cur, &lay->frac, &lay->rate, step, &l, &r);
+        __m128 fmul = _mm_mul_ps(_mm_set_ps1(f), gmul);
+        //mix low frames interleaved with unpacklo
+        align[i] = _mm_add_ps(align[i], _mm_mul_ps(_mm_unpacklo_ps(l, r), fmul));
+        //mix high frames interleaved with unpackhi
+        align[i+1] = _mm_add_ps(align[i+1], _mm_mul_ps(_mm_unpackhi_ps(l, r), fmul));
+        //advance fade and cursor
+        atmxMixAdvance(lay, mode, &cur, 4, adv);
+    }
+    //never leave the cursor past the end, so that regular kernels can take over
+    atmxMixWrap(lay, mode, &loop, &cur);
+    //swap back cursor if unchanged
+    if (!ATMX_CSWAP(&lay->cursor, &old, cur)) cur = old;
+    //return new cursor
+    return cur;
+}
+static int32_t atmxMixRead4 (struct atomix_sound* snd, int lev, int32_t cur, float* frac, float* rate, float step, __m128* l, __m128* r) {
+    //gather both neighbours of 4 fractional positions, stepping and ramping the rate after each
+    //positions are scaled down to the mipmap level, which keeps them exact as cursors are multiples of 4
+    float l0[4], l1[4], r0[4], r1[4], t[4], pos = *frac, rt = *rate, scale = 1.0f/(float)(1 << lev);
+    for (int k = 0; k < 4; k++) {
+        float lpos = pos*scale; int32_t ipos = (int32_t)lpos; t[k] = lpos - (float)ipos;
+        atmxMixFrame(snd, lev, (cur >> lev) + ipos, &l0[k], &r0[k]);
+        atmxMixFrame(snd, lev, (cur >> lev) + ipos + 1, &l1[k], &r1[k]);
+        rt += step; pos += rt;
+    }
+    //kept in locals until here, as sound data could otherwise alias them
+    *frac = pos; *rate = rt;
+    //interpolate linearly using SSE
+    __m128 tv = _mm_loadu_ps(t), a = _mm_loadu_ps(l0), b = _mm_loadu_ps(r0);
+    *l = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(l1), a), tv));
+    *r = _mm_add_ps(b, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(r1), b), tv));
+    //return whole multiple of 4 frames passed, keeping the remainder fractional
+    int32_t adv = (int32_t)*frac & ~3; *frac -= (float)adv;
+    return adv;
+}
+static int32_t atmxMixUnison (struct atmx_layer* lay, uint8_t flag, int32_t cur, float rate, int uni, struct atmx_f2 g, __m128* align, uint32_t asize) {
+    //cache cursor and determine what to do with it
+    int32_t old = cur; int mode = atmxMixMode(lay, flag, cur, rate), loop = (flag == ATOMIX_LOOP);
+    //copy rate offsets and gains padded with silent copies, per frame rate step, and mipmap level to read
+    float dm[ATMX_UNISON], gl[ATMX_UNISON], gr[ATMX_UNISON];
+    float step = atmxMixRate(lay, rate, (float)(asize*2));
+    int lev = atmxMixLevel(lay->snd, rate*atmxUnisonSetup(lay, uni, g, dm, gl, gr));
+    //copies in SSE lanes, 4 at a time
+    int ng = (uni + 3) >> 2; __m128 off[ATMX_UNISON/4], dmv[ATMX_UNISON/4], glv[ATMX_UNISON/4], grv[ATMX_UNISON/4];
+    for (int j = 0; j < ng; j++) {
+        off[j] = _mm_loadu_ps(&lay->unis.off[j*4]); dmv[j] = _mm_loadu_ps(&dm[j*4]);
+        glv[j] = _mm_loadu_ps(&gl[j*4]); grv[j] = _mm_loadu_ps(&gr[j*4]);
+    }
+    float pos = lay->frac, rt = lay->rate, scale = 1.0f/(float)(1 << lev);
+    //data of the mipmap level and the range of indices that can be read without wrapping
+    float* data = lev ? lay->snd->mip[lev-1] : (float*)lay->snd->data; int cha = lay->snd->cha; int32_t lo, hi;
+    atmxMixRange(lay, lev, loop, cur, &lo, &hi);
+    for (uint32_t i = 0; i < asize; i += 2) {
+        //quit if faded out or at end, wrapping around if looping
+        float f = atmxMixBegin(lay, mode, &loop, &cur);
+        if (f < 0.0f) break;
+        //each frame as left and right vectors with a lane per copy
+        __m128 l[4], r[4];
+        for (int k = 0; k < 4; k++) {
+            l[k] = r[k] = _mm_setzero_ps();
+            for (int j = 0; j < ng; j++) {
+                //gather both neighbours of each copy position at the mipmap level
+                float p[4], t0[5], t1[5], t2[5], t3[5];
+                _mm_storeu_ps(p, _mm_mul_ps(_mm_add_ps(_mm_set_ps1(pos), off[j]), _mm_set_ps1(scale)));
+                atmxMixTap(lay, data, cha, lev, loop, cur, lo, hi, p[0], t0);
+                atmxMixTap(lay, data, cha, lev, loop, cur, lo, hi, p[1], t1);
+                atmxMixTap(lay, data, cha, lev, loop, cur, lo, hi, p[2], t2);
+                atmxMixTap(lay, data, cha, lev, loop, cur, lo, hi, p[3], t3);
+                //interpolate all copies at once and apply their gains, building vectors from registers
+                __m128 tv = _mm_setr_ps(t0[0], t1[0], t2[0], t3[0]);
+                __m128 a = _mm_setr_ps(t0[1], t1[1], t2[1], t3[1]), b = _mm_setr_ps(t0[2], t1[2], t2[2], t3[2]);
+                __m128 c = _mm_setr_ps(t0[3], t1[3], t2[3], t3[3]), d = _mm_setr_ps(t0[4], t1[4], t2[4], t3[4]);
+                l[k] = _mm_add_ps(l[k], _mm_mul_ps(_mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(c, a), tv)), glv[j]));
+                r[k] = _mm_add_ps(r[k], _mm_mul_ps(_mm_add_ps(b, _mm_mul_ps(_mm_sub_ps(d, b), tv)), grv[j]));
+                //copies drift from the center by their rate offset
+                off[j] = _mm_add_ps(off[j], _mm_mul_ps(_mm_set_ps1(rt), dmv[j]));
+            }
+            rt += step; pos += rt;
+        }
+        //transpose so each vector holds one copy lane over 4 frames, then sum the lanes
+        _MM_TRANSPOSE4_PS(l[0], l[1], l[2], l[3]);
+        _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+        __m128 fmul = _mm_set_ps1(f);
+        __m128 ls = _mm_mul_ps(_mm_add_ps(_mm_add_ps(l[0], l[1]), _mm_add_ps(l[2], l[3])), fmul);
+        __m128 rs = _mm_mul_ps(_mm_add_ps(_mm_add_ps(r[0], r[1]), _mm_add_ps(r[2], r[3])), fmul);
+        //mix low frames interleaved with unpacklo
+        align[i] = _mm_add_ps(align[i], _mm_unpacklo_ps(ls, rs));
+        //mix high frames interleaved with unpackhi
+        align[i+1] = _mm_add_ps(align[i+1], _mm_unpackhi_ps(ls, rs));
+        //advance fade and cursor by whole multiples of 4 frames, keeping the remainder fractional
+        int32_t adv = (int32_t)pos & ~3; pos -= (float)adv;
+        atmxMixAdvance(lay, mode, &cur, 4, adv);
+    }
+    //store rate, fractional cursor, and copy positions
+    lay->frac = pos; lay->rate = rt;
+    for (int j = 0; j < ng; j++) _mm_storeu_ps(&lay->unis.off[j*4], off[j]);
+    //never leave the cursor past the end, so that regular kernels can take over
+    atmxMixWrap(lay, mode, &loop, &cur);
+    //swap back cursor if unchanged
+    if (!ATMX_CSWAP(&lay->cursor, &old, cur)) cur = old;
+    //return new cursor
+    return cur;
+}
+static int32_t atmxMixGranular (struct atmx_layer* lay, uint8_t flag, int32_t cur, float rate, struct atmx_f2 g, __m128* align, uint32_t asize) {
+    //cache cursor and determine what to do with it
+    int32_t old = cur; int mode = atmxMixMode(lay, flag, cur, rate), loop = (flag == ATOMIX_LOOP);
+    //per frame rate step, grain parameters of this mix, and mipmap level to read
+    float step = atmxMixRate(lay, rate, (float)(asize*2));
+    int lev = atmxMixLevel(lay->snd, rate*atmxGrainSetup(lay, g));
+    struct atmx_granular* gs = &lay->gran; float pos = lay->frac, rt = lay->rate;
+    __m128 scale = _mm_set_ps1(1.0f/(float)(1 << lev)), one = _mm_set_ps1(1.0f), four = _mm_set_ps1(4.0f);
+    //data of the mipmap level and the range of indices that can be read without wrapping
+    float* data = lev ? lay->snd->mip[lev-1] : (float*)lay->snd->data; int cha = lay->snd->cha; int32_t lo, hi;
+    atmxMixRange(lay, lev, loop, cur, &lo, &hi);
+    for (uint32_t i = 0; i < asize; i += 2) {
+        //quit if faded out or at end, wrapping around if looping
+        float f = atmxMixBegin(lay, mode, &loop, &cur);
+        if (f < 0.0f) break;
+        //retire finished grains and spawn those due within these 4 frames
+        atmxGrainTick(lay, loop, cur, pos, rt, 4);
+        //each frame as left and right vectors with a lane per grain
+        __m128 l[4], r[4];
+        for (int k = 0; k < 4; k++) l[k] = r[k] = _mm_setzero_ps();
+        for (int j = 0; j < ATMX_GRAINS; j += 4) {
+            //skip groups of 4 grains that are all free
+            __m128 ilen = _mm_loadu_ps(&gs->ilen[j]);
+            if (!_mm_movemask_ps(_mm_cmpgt_ps(ilen, _mm_setzero_ps()))) continue;
+            __m128 off = _mm_loadu_ps(&gs->off[j]), grt = _mm_loadu_ps(&gs->rate[j]), age = _mm_loadu_ps(&gs->age[j]);
+            __m128 glv = _mm_loadu_ps(&gs->gl[j]), grv = _mm_loadu_ps(&gs->gr[j]); int32_t* b = &gs->base[j];
+            for (int k = 0; k < 4; k++) {
+                //gather both neighbours of each grain position at the mipmap level
+                float p[4], t0[5], t1[5], t2[5], t3[5];
+                _mm_storeu_ps(p, _mm_mul_ps(off, scale));
+                atmxMixTap(lay, data, cha, lev, loop, b[0], lo, hi, p[0], t0);
+                atmxMixTap(lay, data, cha, lev, loop, b[1], lo, hi, p[1], t1);
+                atmxMixTap(lay, data, cha, lev, loop, b[2], lo, hi, p[2], t2);
+                atmxMixTap(lay, data, cha, lev, loop, b[3], lo, hi, p[3], t3);
+                //squared parabolic window of each grain from its age relative to its length, 0 for free grains
+                __m128 x = _mm_mul_ps(age, ilen), w = _mm_mul_ps(_mm_mul_ps(four, x), _mm_sub_ps(one, x));
+                w = _mm_mul_ps(w, w);
+                //interpolate all grains at once and apply their windowed gains
+                __m128 tv = _mm_setr_ps(t0[0], t1[0], t2[0], t3[0]);
+                __m128 a = _mm_setr_ps(t0[1], t1[1], t2[1], t3[1]), c = _mm_setr_ps(t0[2], t1[2], t2[2], t3[2]);
+                __m128 d = _mm_setr_ps(t0[3], t1[3], t2[3], t3[3]), e = _mm_setr_ps(t0[4], t1[4], t2[4], t3[4]);
+                l[k] = _mm_add_ps(l[k], _mm_mul_ps(_mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(d, a), tv)), _mm_mul_ps(glv, w)));
+                r[k] = _mm_add_ps(r[k], _mm_mul_ps(_mm_add_ps(c, _mm_mul_ps(_mm_sub_ps(e, c), tv)), _mm_mul_ps(grv, w)));
+                //grains age by a frame and move by their own rate
+                age = _mm_add_ps(age, one); off = _mm_add_ps(off, grt);
+            }
+            _mm_storeu_ps(&gs->off[j], off); _mm_storeu_ps(&gs->age[j], age);
+        }
+        //transpose so each vector holds one grain lane over 4 frames, then sum the lanes
+        _MM_TRANSPOSE4_PS(l[0], l[1], l[2], l[3]);
+        _MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+        __m128 fmul = _mm_set_ps1(f);
+        __m128 ls = _mm_mul_ps(_mm_add_ps(_mm_add_ps(l[0], l[1]), _mm_add_ps(l[2], l[3])), fmul);
+        __m128 rs = _mm_mul_ps(_mm_add_ps(_mm_add_ps(r[0], r[1]), _mm_add_ps(r[2], r[3])), fmul);
+        //mix low frames interleaved with unpacklo
+        align[i] = _mm_add_ps(align[i], _mm_unpacklo_ps(ls, rs));
+        //mix high frames interleaved with unpackhi
+        align[i+1] = _mm_add_ps(align[i+1], _mm_unpackhi_ps(ls, rs));
+        //step and ramp the rate of the cursor over 4 frames, advancing by whole multiples of 4 frames
+        for (int k = 0; k < 4; k++) { rt += step; pos += rt; }
+        int32_t adv = (int32_t)pos & ~3; pos -= (float)adv;
+        atmxMixAdvance(lay, mode, &cur, 4, adv);
+    }
+    //store rate and fractional cursor
+    lay->frac = pos; lay->rate = rt;
+    //never leave the cursor past the end, so that regular kernels can take over
+    atmxMixWrap(lay, mode, &loop, &cur);
+    //swap back cursor if unchanged
+    if (!ATMX_CSWAP(&lay->cursor, &old, cur)) cur = old;
+    //return new cursor
+    return cur;
+}
 #else
-static void atmxMixLayer (struct atmx_layer* lay, float vol, float* buff, uint32_t fnum) {
+static void atmxMixLayer (struct atomix_mixer* mix, struct atmx_layer* lay, float vol, float* buff, uint32_t fnum, int virt) {
     //load flag value atomically first
     uint8_t flag = ATMX_LOAD(&lay->flag);
     //return if flag cleared
     if (flag == 0) return;
     //atomically load cursor
     int32_t cur = ATMX_LOAD(&lay->cursor);
-    //atomically load left and right gain
+    //atomically load left and right gain, replacing the pan if positional
+    float dot = 0.0f; int pos = atmxDirection(mix, lay, &dot);
     struct atmx_f2 g = ATMX_LOAD(&lay->gain);
+    if (pos) g = atmxGainf2(g.l + g.r, -dot);
+    //atomically load grain size, state is stale unless granular
+    int gra = (ATMX_LOAD(&lay->gsize) > 0);
+    if (!gra) lay->gran.on = 0;
+    //atomically load unison voices, state is stale unless more than one and not granular
+    int uni = ATMX_LOAD(&lay->uni);
+    if ((uni < 2)||gra) { uni = 0; lay->unis.on = 0; }
+    //positional sounds are rendered binaurally instead if enabled and neither, state is stale otherwise
+    int bin = pos&&(mix->bk > 0.0f)&&(!uni)&&(!gra);
+    if (!bin) lay->bin.on = 0;
+    //load playback rate of this mix, the fractional cursor only matters while pitched, unison, or granular
+    float rate = lay->trate; int pit = atmxPitched(lay, rate);
+    if ((!pit)&&(!uni)&&(!gra)) lay->frac = 0.0f;
     //multiply volume into gain
     g.l *= vol; g.r *= vol;
+    #ifdef ATOMIX_PROFILE
+        //remember sound, clock, cursor, and whether fading for profiling
+        struct atomix_sound* psnd = lay->snd; uint64_t pclk = ATOMIX_CLOCK(); int32_t pcur = cur;
+        int pfade = (flag < 3) ? (lay->fade > 0) : (lay->fade < lay->fmax);
+    #endif
     //action based on flag
     if (flag < 3) {
         //ATOMIX_STOP or ATOMIX_HALT, fade out if not faded or at end
         if ((lay->fade > 0)&&(cur < lay->end)) 
-            if (lay->snd->cha == 1)
+            if (virt)
+                cur = atmxMixSkip(lay, flag, cur, rate, fnum, 1);
+            else if (gra)
+                cur = atmxMixGranular(lay, flag, cur, rate, g, buff, fnum);
+            else if (uni)
+                cur = atmxMixUnison(lay, flag, cur, rate, uni, g, buff, fnum);
+            else if (bin)
+                cur = atmxMixBinaural(mix, lay, flag, cur, dot, rate, g.l + g.r, buff, fnum);
+            else if (pit)
+                cur = atmxMixPitch(lay, flag, cur, rate, g, buff, fnum);
+            else if (lay->snd->cha == 1)
                 cur = atmxMixFadeMono(lay, cur, g, buff, fnum);
             else
                 cur = atmxMixFadeStereo(lay, cur, g, buff, fnum);
         //clear flag if ATOMIX_STOP and fully faded or at end
-        if ((flag == ATOMIX_STOP)&&((lay->fade == 0)||(cur == lay->end))) ATMX_STORE(&lay->flag, (uint8_t)0);
+        if ((flag == ATOMIX_STOP)&&((lay->fade == 0)||(cur >= lay->end))) ATMX_STORE(&lay->flag, (uint8_t)0);
     } else {
-        //ATOMIX_PLAY or ATOMIX_LOOP, play including fade in
-        if (lay->snd->cha == 1)
+        //ATOMIX_PLAY or ATOMIX_LOOP, play including fade in, re-entering a loop left before if looping again
+        if ((flag == ATOMIX_LOOP)&&(lay->end != lay->lend)&&ATMX_LOAD(&lay->loops)) lay->end = lay->lend;
+        if (virt)
+            cur = atmxMixSkip(lay, flag, cur, rate, fnum, 1);
+        else if (gra)
+            cur = atmxMixGranular(lay, flag, cur, rate, g, buff, fnum);
+        else if (uni)
+            cur = atmxMixUnison(lay, flag, cur, rate, uni, g, buff, fnum);
+        else if (bin)
+            cur = atmxMixBinaural(mix, lay, flag, cur, dot, rate, g.l + g.r, buff, fnum);
+        else if (pit)
+            cur = atmxMixPitch(lay, flag, cur, rate, g, buff, fnum);
+        else if (lay->snd->cha == 1)
             cur = atmxMixPlayMono(lay, (flag == ATOMIX_LOOP), cur, g, buff, fnum);
         else
             cur = atmxMixPlayStereo(lay, (flag == ATOMIX_LOOP), cur, g, buff, fnum);
         //clear flag if ATOMIX_PLAY and the cursor has reached the end
-        if ((flag == ATOMIX_PLAY)&&(cur == lay->end)) ATMX_CSWAP(&lay->flag, &flag, (uint8_t)0);
+        if ((flag == ATOMIX_PLAY)&&(cur >= lay->end)) ATMX_CSWAP(&lay->flag, &flag, (uint8_t)0);
+        //switch to ATOMIX_PLAY once out of loops and past the loop, or with no tail to move on to
+        if ((flag == ATOMIX_LOOP)&&(lay->end == lay->tail)&&(ATMX_LOAD(&lay->loops) == 0))
+            ATMX_CSWAP(&lay->flag, &flag, (uint8_t)ATOMIX_PLAY);
     }
+    //land exactly on the target rate, as stepping towards it frame by frame accumulates rounding error
+    lay->rate = rate;
+    #ifdef ATOMIX_PROFILE
+        //attribute elapsed cycles and path taken to the sound
+        atmxProfile(psnd, ATOMIX_CLOCK() - pclk, pfade, (flag == ATOMIX_LOOP)&&(cur < pcur));
+    #endif
 }
 static int32_t atmxMixFadeMono (struct atmx_layer* lay, int32_t cur, struct atmx_f2 g, float* buff, uint32_t fnum) {
     //cache cursor
@@ -714,7 +2125,7 @@ static int32_t atmxMixFadeMono (struct atmx_layer* lay, int32_t cur, struct atmx
         //continue playback to end without fade out
         for (uint32_t i = 0; i < fnum*2; i += 2) {
             //quit if cursor at end
-            if (cur == lay->end) break;
+            if (cur >= lay->end) break;
             //mix if cursor within sound
             if (cur >= 0) {
                 //load 1 sample from data (this is 1 frame)
@@ -760,7 +2171,7 @@ static int32_t atmxMixFadeStereo (struct atmx_layer* lay, int32_t cur, struct at
         //continue playback to end without fade out
         for (uint32_t i = 0; i < fnum*2; i += 2) {
             //quit if cursor at end
-            if (cur == lay->end) break;
+            if (cur >= lay->end) break;
             //mix if cursor within sound
             if (cur >= 0) {
                 //mod for repeating and convert to float offset
@@ -787,11 +2198,9 @@ static int32_t atmxMixPlayMono (struct atmx_layer* lay, int loop, int32_t cur, s
         //perform fade in
         for (uint32_t i = 0; i < fnum*2; i += 2) {
             //check if cursor at end
-            if (cur == lay->end) {
-                //quit unless looping
-                if (!loop) break;
-                //wrap around if looping
-                cur = lay->start;
+            if (cur >= lay->end) {
+                //quit unless looping, wrapping around or moving on past a loop that ran out otherwise
+                if (!atmxMixLoop(lay, &loop, &cur)) break;
             }
             //mix if cursor within sound
             if (cur >= 0) {
@@ -813,11 +2222,9 @@ static int32_t atmxMixPlayMono (struct atmx_layer* lay, int loop, int32_t cur, s
         //regular playback
         for (uint32_t i = 0; i < fnum*2; i += 2) {
             //check if cursor at end
-            if (cur == lay->end) {
-                //quit unless looping
-                if (!loop) break;
-                //wrap around if looping
-                cur = lay->start;
+            if (cur >= lay->end) {
+                //quit unless looping, wrapping around or moving on past a loop that ran out otherwise
+                if (!atmxMixLoop(lay, &loop, &cur)) break;
             }
             //mix if cursor within sound
             if (cur >= 0) {
@@ -845,11 +2252,9 @@ static int32_t atmxMixPlayStereo (struct atmx_layer* lay, int loop, int32_t cur,
         //perform fade in
         for (uint32_t i = 0; i < fnum*2; i += 2) {
             //check if cursor at end
-            if (cur == lay->end) {
-                //quit unless looping
-                if (!loop) break;
-                //wrap around if looping
-                cur = lay->start;
+            if (cur >= lay->end) {
+                //quit unless looping, wrapping around or moving on past a loop that ran out otherwise
+                if (!atmxMixLoop(lay, &loop, &cur)) break;
             }
             //mix if cursor within sound
             if (cur >= 0) {
@@ -871,11 +2276,9 @@ static int32_t atmxMixPlayStereo (struct atmx_layer* lay, int loop, int32_t cur,
         //regular playback
         for (uint32_t i = 0; i < fnum*2; i += 2) {
             //check if cursor at end
-            if (cur == lay->end) {
-                //quit unless looping
-                if (!loop) break;
-                //wrap around if looping
-                cur = lay->start;
+            if (cur >= lay->end) {
+                //quit unless looping, wrapping around or moving on past a loop that ran out otherwise
+                if (!atmxMixLoop(lay, &loop, &cur)) break;
             }
             //mix if cursor within sound
             if (cur >= 0) {
@@ -895,12 +2298,978 @@ static int32_t atmxMixPlayStereo (struct atmx_layer* lay, int loop, int32_t cur,
     //return new cursor
     return cur;
 }
+static int32_t atmxMixBinaural (struct atomix_mixer* mix, struct atmx_layer* lay, uint8_t flag, int32_t cur, float dot, float rate, float gain, float* buff, uint32_t fnum) {
+    //cache cursor and determine what to do with it
+    int32_t old = cur; int mode = atmxMixMode(lay, flag, cur, rate), loop = (flag == ATOMIX_LOOP);
+    //determine whether to read at a fractional cursor, how to ramp the rate, and which mipmap level to read
+    int pit = atmxPitched(lay, rate); float step = atmxMixRate(lay, rate, (float)fnum);
+    int lev = atmxMixLevel(lay->snd, rate);
+    struct atmx_binaural* bin = &lay->bin;
+    //compute target parameters, snapping to them with cleared state if not current
+    float del[2], b0[2], b1[2];
+    atmxBinauralTarget(mix, dot, del, b0, b1);
+    if (!bin->on) {
+        memset(bin, 0, sizeof(struct atmx_binaural)); bin->on = 1;
+        memcpy(bin->del, del, sizeof(del)); memcpy(bin->b0, b0, sizeof(b0)); memcpy(bin->b1, b1, sizeof(b1));
+    }
+    //per frame steps that reach the targets at the end of this mix
+    float n = (float)fnum, ds[2], d0[2], d1[2];
+    for (int j = 0; j < 2; j++) {
+        ds[j] = (del[j] - bin->del[j])/n; d0[j] = (b0[j] - bin->b0[j])/n; d1[j] = (b1[j] - bin->b1[j])/n;
+    }
+    for (uint32_t i = 0; i < fnum*2; i += 2) {
+        //quit if faded out or at end, wrapping around if looping
+        float f = atmxMixBegin(lay, mode, &loop, &cur);
+        if (f < 0.0f) break;
+        //write frame with fade applied into delay line, interpolated if pitched, silence before the start of the sound
+        int32_t adv = 1;
+        if (pit) {
+            float l, r; adv = atmxMixRead1(lay->snd, lev, cur, &lay->frac, &lay->rate, step, &l, &r);
+            bin->hist[bin->w & (ATMX_BHIST - 1)] = (l + r)*0.5f*f;
+        } else bin->hist[bin->w & (ATMX_BHIST - 1)] = (cur >= 0) ? atmxMixMono1(lay->snd, cur)*f : 0.0f;
+        for (int j = 0; j < 2; j++) {
+            //read ear with linear interpolation
+            bin->del[j] += ds[j]; bin->b0[j] += d0[j]; bin->b1[j] += d1[j];
+            float pos = (float)((bin->w & (ATMX_BHIST - 1)) + ATMX_BHIST) - bin->del[j];
+            int32_t ipos = (int32_t)pos; float frac = pos - (float)ipos;
+            float x = bin->hist[ipos & (ATMX_BHIST - 1)]*(1.0f - frac) + bin->hist[(ipos + 1) & (ATMX_BHIST - 1)]*frac;
+            //first-order head shadow filter
+            float y = bin->b0[j]*x + bin->b1[j]*bin->x1[j] - mix->ba1*bin->y1[j];
+            bin->x1[j] = x; bin->y1[j] = y;
+            //mix sample of this ear, half the gain so a sound straight ahead matches the centre of the pan law
+            buff[i+j] += y*gain*0.5f;
+        }
+        bin->w++;
+        //advance fade and cursor
+        atmxMixAdvance(lay, mode, &cur, 1, adv);
+    }
+    //never leave the cursor past the end, so that regular kernels can take over
+    atmxMixWrap(lay, mode, &loop, &cur);
+    //swap back cursor if unchanged
+    if (!ATMX_CSWAP(&lay->cursor, &old, cur)) cur = old;
+    //return new cursor
+    return cur;
+}
+static float atmxMixMono1 (struct atomix_sound* snd, int32_t cur) {
+    //load 1 sample from data if already mono (this is 1 frame)
+    if (snd->cha == 1) return snd->data[cur % snd->len];
+    //otherwise average left and right of the frame
+    int32_t off = (cur % snd->len) << 1;
+    return (snd->data[off] + snd->data[off+1])*0.5f;
+}
+static int32_t atmxMixPitch (struct atmx_layer* lay, uint8_t flag, int32_t cur, float rate, struct atmx_f2 g, float* buff, uint32_t fnum) {
+    //cache cursor and determine what to do with it
+    int32_t old = cur; int mode = atmxMixMode(lay, flag, cur, rate), loop = (flag == ATOMIX_LOOP);
+    //per frame step that reaches the target rate at the end of this mix, and mipmap level to read
+    float step = atmxMixRate(lay, rate, (float)fnum); int lev = atmxMixLevel(lay->snd, rate);
+    for (uint32_t i = 0; i < fnum*2; i += 2) {
+        //quit if faded out or at end, wrapping around if looping
+        float f = atmxMixBegin(lay, mode, &loop, &cur);
+        if (f < 0.0f) break;
+        //read interpolated frame and mix it
+        float l, r; int32_t adv = atmxMixRead1(lay->snd, lev, cur, &lay->frac, &lay->rate, step, &l, &r);
+        buff[i] += l*g.l*f;
+        buff[i+1] += r*g.r*f;
+        //advance fade and cursor
+        atmxMixAdvance(lay, mode, &cur, 1, adv);
+    }
+    //never leave the cursor past the end, so that regular kernels can take over
+    atmxMixWrap(lay, mode, &loop, &cur);
+    //swap back cursor if unchanged
+    if (!ATMX_CSWAP(&lay->cursor, &old, cur)) cur = old;
+    //return new cursor
+    return cur;
+}
+static int32_t atmxMixRead1 (struct atomix_sound* snd, int lev, int32_t cur, float* frac, float* rate, float step, float* l, float* r) {
+    //read both neighbours of the fractional position scaled down to the mipmap level and interpolate linearly
+    int32_t base = cur >> lev; float lpos = ((float)(cur - (base << lev)) + *frac)/(float)(1 << lev);
+    int32_t ipos = (int32_t)lpos; float t = lpos - (float)ipos, l0, l1, r0, r1;
+    atmxMixFrame(snd, lev, base + ipos, &l0, &r0);
+    atmxMixFrame(snd, lev, base + ipos + 1, &l1, &r1);
+    *l = l0 + (l1 - l0)*t; *r = r0 + (r1 - r0)*t;
+    //step and ramp the rate, returning whole frames passed and keeping the remainder fractional
+    *rate += step; *frac += *rate;
+    int32_t adv = (int32_t)*frac; *frac -= (float)adv;
+    return adv;
+}
+static int32_t atmxMixUnison (struct atmx_layer* lay, uint8_t flag, int32_t cur, float rate, int uni, struct atmx_f2 g, float* buff, uint32_t fnum) {
+    //cache cursor and determine what to do with it
+    int32_t old = cur; int mode = atmxMixMode(lay, flag, cur, rate), loop = (flag == ATOMIX_LOOP);
+    //copy rate offsets and gains, per frame rate step, and mipmap level to read
+    float dm[ATMX_UNISON], gl[ATMX_UNISON], gr[ATMX_UNISON];
+    float step = atmxMixRate(lay, rate, (float)fnum);
+    int lev = atmxMixLevel(lay->snd, rate*atmxUnisonSetup(lay, uni, g, dm, gl, gr));
+    float* off = lay->unis.off; float scale = 1.0f/(float)(1 << lev);
+    //data of the mipmap level and the range of indices that can be read without wrapping
+    float* data = lev ? lay->snd->mip[lev-1] : lay->snd->data; int cha = lay->snd->cha; int32_t lo, hi;
+    atmxMixRange(lay, lev, loop, cur, &lo, &hi);
+    for (uint32_t i = 0; i < fnum*2; i += 2) {
+        //quit if faded out or at end, wrapping around if looping
+        float f = atmxMixBegin(lay, mode, &loop, &cur);
+        if (f < 0.0f) break;
+        int32_t base = cur >> lev; float rem = (float)(cur - (base << lev));
+        for (int j = 0; j < uni; j++) {
+            //read both neighbours of the copy position at the mipmap level and interpolate linearly
+            float tap[5];
+            atmxMixTap(lay, data, cha, lev, loop, base << lev, lo, hi, (rem + lay->frac + off[j])*scale, tap);
+            //mix copy with its gains
+            buff[i] += (tap[1] + (tap[3] - tap[1])*tap[0])*gl[j]*f;
+            buff[i+1] += (tap[2] + (tap[4] - tap[2])*tap[0])*gr[j]*f;
+            //copies drift from the center by their rate offset
+            off[j] += lay->rate*dm[j];
+        }
+        //step and ramp the rate, advancing by whole frames and keeping the remainder fractional
+        lay->rate += step; lay->frac += lay->rate;
+        int32_t adv = (int32_t)lay->frac; lay->frac -= (float)adv;
+        //advance fade and cursor
+        atmxMixAdvance(lay, mode, &cur, 1, adv);
+    }
+    //never leave the cursor past the end, so that regular kernels can take over
+    atmxMixWrap(lay, mode, &loop, &cur);
+    //swap back cursor if unchanged
+    if (!ATMX_CSWAP(&lay->cursor, &old, cur)) cur = old;
+    //return new cursor
+    return cur;
+}
+static int32_t atmxMixGranular (struct atmx_layer* lay, uint8_t flag, int32_t cur, float rate, struct atmx_f2 g, float* buff, uint32_t fnum) {
+    //cache cursor and determine what to do with it
+    int32_t old = cur; int mode = atmxMixMode(lay, flag, cur, rate), loop = (flag == ATOMIX_LOOP);
+    //per frame rate step, grain parameters of this mix, and mipmap level to read
+    float step = atmxMixRate(lay, rate, (float)fnum);
+    int lev = atmxMixLevel(lay->snd, rate*atmxGrainSetup(lay, g));
+    struct atmx_granular* gs = &lay->gran; float scale = 1.0f/(float)(1 << lev);
+    //data of the mipmap level and the range of indices that can be read without wrapping
+    float* data = lev ? lay->snd->mip[lev-1] : lay->snd->data; int cha = lay->snd->cha; int32_t lo, hi;
+    atmxMixRange(lay, lev, loop, cur, &lo, &hi);
+    for (uint32_t i = 0; i < fnum*2; i += 2) {
+        //quit if faded out or at end, wrapping around if looping
+        float f = atmxMixBegin(lay, mode, &loop, &cur);
+        if (f < 0.0f) break;
+        //retire finished grains and spawn those due at this frame
+        atmxGrainTick(lay, loop, cur, lay->frac, lay->rate, 1);
+        for (int j = 0; j < ATMX_GRAINS; j++) {
+            //skip free grains
+            if (gs->ilen[j] == 0.0f) continue;
+            //read both neighbours of the grain position at the mipmap level and interpolate linearly
+            float tap[5];
+            atmxMixTap(lay, data, cha, lev, loop, gs->base[j], lo, hi, gs->off[j]*scale, tap);
+            //squared parabolic window from the age of the grain relative to its length
+            float x = gs->age[j]*gs->ilen[j], w = 4.0f*x*(1.0f - x); w *= w*f;
+            //mix grain with its windowed gains
+            buff[i] += (tap[1] + (tap[3] - tap[1])*tap[0])*gs->gl[j]*w;
+            buff[i+1] += (tap[2] + (tap[4] - tap[2])*tap[0])*gs->gr[j]*w;
+            //grain ages by a frame and moves by its own rate
+            gs->age[j] += 1.0f; gs->off[j] += gs->rate[j];
+        }
+        //step and ramp the rate, advancing by whole frames and keeping the remainder fractional
+        lay->rate += step; lay->frac += lay->rate;
+        int32_t adv = (int32_t)lay->frac; lay->frac -= (float)adv;
+        //advance fade and cursor
+        atmxMixAdvance(lay, mode, &cur, 1, adv);
+    }
+    //never leave the cursor past the end, so that regular kernels can take over
+    atmxMixWrap(lay, mode, &loop, &cur);
+    //swap back cursor if unchanged
+    if (!ATMX_CSWAP(&lay->cursor, &old, cur)) cur = old;
+    //return new cursor
+    return cur;
+}
+#endif
+#ifdef ATOMIX_SHM
+static size_t atmxBankRecord (struct atomix_bank* bank, size_t off, struct atmx_bankrec* rec) {
+    //copy the record header at given offset, as another process writes the memory, if it fits into the mapping
+    if ((off > bank->size)||(bank->size - off < sizeof(struct atmx_bankrec))) return 0;
+    memcpy(rec, bank->base + off, sizeof(struct atmx_bankrec));
+    //return 0 if malformed, otherwise the size of the record including its data if that fits as well
+    if ((rec->cha < 1)||(rec->cha > 2)||(rec->len < 4)||(rec->len > 0x40000000)||(rec->len & 3)||(rec->flags & ~0xFF)) return 0;
+    size_t bytes = sizeof(struct atmx_bankrec) + ((atmxSoundBytes((uint8_t)rec->cha, rec->len, (uint8_t)rec->flags) + 15) & ~(size_t)15);
+    return (bytes <= bank->size - off) ? bytes : 0;
+}
 #endif
+#ifdef ATOMIX_MLOCK
+static void atmxLock (void* mem, size_t size, int write) {
+    //lock all pages touching the range, which faults them in
+    if (mlock(mem, size) == 0) return;
+    //touch every page instead when over the lock limit, writing only if the memory is writable
+    size_t page = (size_t)sysconf(_SC_PAGESIZE); volatile unsigned char* p = (volatile unsigned char*)mem;
+    for (size_t i = 0; i < size; i += page) if (write) p[i] = p[i]; else (void)p[i];
+    if (size) { if (write) p[size-1] = p[size-1]; else (void)p[size-1]; }
+}
+static void atmxUnlock (void* mem, size_t size) {
+    //unlock only whole pages within the range, as locks do not nest and the first and last page may be shared
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t lo = ((uintptr_t)mem + page - 1) & ~(page - 1), hi = ((uintptr_t)mem + size) & ~(page - 1);
+    if (hi > lo) munlock((void*)lo, hi - lo);
+}
+#endif
+static size_t atmxSoundBytes (uint8_t cha, int32_t rlen, uint8_t flags) {
+    //data of rounded length, followed by mipmaps of half and a quarter of the length
+    int32_t mlen = (flags & ATOMIX_MIPMAP) ? (rlen >> 1) + (rlen >> 2) : 0;
+    return (size_t)(rlen + mlen)*cha*sizeof(float);
+}
+static void atmxSoundInit (struct atomix_sound* snd, uint8_t cha, int32_t rlen, uint8_t flags, void* mem) {
+    //fill in channel and length, and point data and mipmaps into given memory, which is aligned if SSE
+    snd->cha = cha; snd->len = rlen;
+    #ifndef ATOMIX_NO_SSE
+        snd->data = (__m128*)mem;
+    #else
+        snd->data = (float*)mem;
+    #endif
+    if (flags & ATOMIX_MIPMAP) { snd->mip[0] = (float*)mem + rlen*cha; snd->mip[1] = snd->mip[0] + (rlen >> 1)*cha; }
+}
+static struct atomix_sound* atmxSoundAlloc (uint8_t cha, int32_t len, uint8_t flags) {
+    //round length to next multiple of 4
+    int32_t rlen = (len + 3) & ~0x03;
+    //allocate sound struct and space for data, with room for alignment if SSE
+    #ifndef ATOMIX_NO_SSE
+        size_t bytes = sizeof(struct atomix_sound) + atmxSoundBytes(cha, rlen, flags) + 15;
+    #else
+        size_t bytes = sizeof(struct atomix_sound) + atmxSoundBytes(cha, rlen, flags);
+    #endif
+    struct atomix_sound* snd = (struct atomix_sound*)ATOMIX_ZALLOC(bytes);
+    //return if zalloc failed
+    if (!snd) return NULL;
+    //point the sound at the data in allocated space, aligned if SSE
+    #ifndef ATOMIX_NO_SSE
+        atmxSoundInit(snd, cha, rlen, flags, (void*)(((uintptr_t)(void*)&snd[1] + 15) & ~15));
+    #else
+        atmxSoundInit(snd, cha, rlen, flags, &snd[1]);
+    #endif
+    //lock struct and data into memory, faulting them in
+    #ifdef ATOMIX_MLOCK
+        atmxLock(snd, snd->lock = bytes, 1);
+    #endif
+    //return
+    return snd;
+}
+static void atmxSoundFill (struct atomix_sound* snd, float* data, int32_t len, uint8_t cha) {
+    //copy sound data into the aligned buffer, averaging left and right if stereo collapsed to mono
+    float* sdat = (float*)snd->data;
+    if (cha == snd->cha) memcpy(sdat, data, len*cha*sizeof(float));
+    else for (int32_t i = 0; i < len; i++) sdat[i] = (data[i*2] + data[i*2+1])*0.5f;
+    //pad and generate mipmaps
+    atmxSoundFinish(snd, len);
+}
+static void atmxSoundConvert (struct atomix_sound* snd, const void* data, int32_t len, uint8_t cha, uint8_t format) {
+    //convert integer samples into the aligned buffer, averaging left and right if stereo collapsed to mono
+    float* sdat = (float*)snd->data; float scale = atmxPCMScale(format);
+    int32_t num = len*cha, i = 0;
+    if (cha != snd->cha) {
+        for (; i < len; i++) sdat[i] = (atmxPCM(data, format, i*2) + atmxPCM(data, format, i*2 + 1))*(scale*0.5f);
+        atmxSoundFinish(snd, len); return;
+    }
+    #ifndef ATOMIX_NO_SSE
+        __m128 vscl = _mm_set_ps1(scale);
+        #ifdef ATMX_SSE2
+            //with SSE2, widen 16 or 8 samples at a time to 32-bit integers and convert those 4 at a time
+            if (format == ATOMIX_S16) {
+                for (; i + 8 <= num; i += 8) {
+                    //sign extend by interleaving each sample with itself and shifting back down
+                    __m128i x = _mm_loadu_si128((const __m128i*)((const int16_t*)data + i));
+                    _mm_store_ps(sdat + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16)), vscl));
+                    _mm_store_ps(sdat + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16)), vscl));
+                }
+            } else if (format == ATOMIX_U8) {
+                __m128i zero = _mm_setzero_si128(); __m128 bias = _mm_set_ps1(128.0f);
+                for (; i + 16 <= num; i += 16) {
+                    //zero extend by interleaving with zeros, removing the bias after conversion
+                    __m128i x = _mm_loadu_si128((const __m128i*)((const uint8_t*)data + i));
+                    __m128i w[2] = {_mm_unpacklo_epi8(x, zero), _mm_unpackhi_epi8(x, zero)};
+                    for (int k = 0; k < 4; k++) {
+                        __m128i d = (k & 1) ? _mm_unpackhi_epi16(w[k >> 1], zero) : _mm_unpacklo_epi16(w[k >> 1], zero);
+                        _mm_store_ps(sdat + i + k*4, _mm_mul_ps(_mm_sub_ps(_mm_cvtepi32_ps(d), bias), vscl));
+                    }
+                }
+            }
+        #endif
+        //otherwise gather 4 samples at a time and scale them together
+        for (; i + 4 <= num; i += 4)
+            _mm_store_ps(sdat + i, _mm_mul_ps(_mm_setr_ps(atmxPCM(data, format, i), atmxPCM(data, format, i + 1),
+                atmxPCM(data, format, i + 2), atmxPCM(data, format, i + 3)), vscl));
+    #endif
+    //remaining samples (all without SSE) one at a time
+    for (; i < num; i++) sdat[i] = atmxPCM(data, format, i)*scale;
+    //pad and generate mipmaps
+    atmxSoundFinish(snd, len);
+}
+static float* atmxResampleTable (uint8_t cha, uint64_t L, uint64_t M, int32_t* taps) {
+    //cutoff just below the lower of both nyquist frequencies, with a fixed number of zero crossings either side
+    float cut = 0.95f*((L < M) ? (float)L/(float)M : 1.0f);
+    int32_t num = ((int32_t)(2.0f*ATMX_SRCZEROS/cut) + 3) & ~0x03, half = num/2;
+    int32_t phases = (L < ATMX_SRCPHASES) ? (int32_t)L : ATMX_SRCPHASES;
+    //one row of taps per phase, each tap repeated for every channel so stereo frames multiply in place
+    float* tab = (float*)ATOMIX_ZALLOC((size_t)phases*num*cha*sizeof(float));
+    if (!tab) return NULL;
+    for (int32_t p = 0; p < phases; p++) {
+        //Blackman windowed sinc centered at the fraction of this phase, normalized to unity gain
+        float* row = tab + (size_t)p*num*cha; float sum = 0.0f;
+        for (int32_t t = 0; t < num; t++) {
+            float x = (float)(t - half + 1) - (float)p/(float)phases, s = 3.14159265f*cut*x, w = 3.14159265f*x/(float)half;
+            float h = ((x > -1e-6f)&&(x < 1e-6f) ? 1.0f : sinf(s)/s)*((fabsf(x) < half) ? 0.42f + 0.5f*cosf(w) + 0.08f*cosf(2.0f*w) : 0.0f);
+            for (int k = 0; k < cha; k++) row[t*cha + k] = h;
+            sum += h;
+        }
+        for (int32_t t = 0; t < num*cha; t++) row[t] /= sum;
+    }
+    //return taps per phase along with the table
+    *taps = num;
+    return tab;
+}
+static void atmxResample (struct atomix_sound* snd, float* data, int32_t len, uint8_t cha, uint64_t L, uint64_t M, float* tab, int32_t taps) {
+    //resample data into the sound, averaging left and right if stereo collapsed to mono
+    float* sdat = (float*)snd->data; int32_t half = taps/2, stride = taps*cha;
+    uint64_t phases = (L < ATMX_SRCPHASES) ? L : ATMX_SRCPHASES, olen = ((uint64_t)len*L + M - 1)/M;
+    for (uint64_t j = 0; j < olen; j++) {
+        //input frame at or before this output frame and the phase of the fraction in between
+        uint64_t pos = j*M; int64_t in = (int64_t)(pos/L); uint64_t p = ((pos % L)*phases + L/2)/L;
+        if (p == phases) { p = 0; in++; }
+        float* row = tab + p*stride; int64_t first = in - half + 1; float out[2] = {0.0f, 0.0f};
+        #ifndef ATOMIX_NO_SSE
+        if ((first >= 0)&&(first + taps <= len)) {
+            //whole filter inside the data, multiply 4 samples at a time against taps repeated per channel
+            float* src = data + first*cha; __m128 acc = _mm_setzero_ps();
+            for (int32_t t = 0; t < stride; t += 4) acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(src + t), _mm_loadu_ps(row + t)));
+            //fold upper half onto lower half, which leaves left and right of stereo apart
+            acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+            if (cha == 1) acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(1, 1, 1, 1)));
+            _mm_store_ss(&out[0], acc); _mm_store_ss(&out[1], _mm_shuffle_ps(acc, acc, _MM_SHUFFLE(1, 1, 1, 1)));
+        } else
+        #endif
+        //otherwise (always without SSE) one sample at a time, treating everything outside the data as silence
+        for (int32_t t = 0; t < taps; t++) {
+            if ((first + t < 0)||(first + t >= len)) continue;
+            for (int k = 0; k < cha; k++) out[k] += row[t*cha + k]*data[(first + t)*cha + k];
+        }
+        //store in the sound
+        if (snd->cha == cha) for (int k = 0; k < cha; k++) sdat[j*cha + k] = out[k];
+        else sdat[j] = (out[0] + out[1])*0.5f;
+    }
+    //pad and generate mipmaps
+    atmxSoundFinish(snd, (int32_t)olen);
+}
+static void atmxSoundFinish (struct atomix_sound* snd, int32_t len) {
+    //silence the rounded up remainder
+    float* sdat = (float*)snd->data;
+    memset(sdat + len*snd->cha, 0, (snd->len - len)*snd->cha*sizeof(float));
+    //generate each mipmap level from the previous one
+    if (snd->mip[0]) {
+        atmxDecimate((float*)snd->data, snd->len, snd->cha, snd->mip[0]);
+        atmxDecimate(snd->mip[0], snd->len >> 1, snd->cha, snd->mip[1]);
+    }
+}
+static uint64_t atmxHash (float* data, size_t num) {
+    //4 independent multiply-xorshift lanes over 32-bit words, so consecutive words never wait on each other
+    uint64_t h[4] = {0x243F6A8885A308D3ull, 0x13198A2E03707344ull, 0xA4093822299F31D0ull, 0x082EFA98EC4E6C89ull};
+    uint32_t w[4]; size_t i = 0;
+    for (; i + 4 <= num; i += 4) {
+        memcpy(w, data + i, sizeof(w));
+        for (int k = 0; k < 4; k++) { h[k] = (h[k] ^ w[k])*0x9E3779B97F4A7C15ull; h[k] ^= h[k] >> 32; }
+    }
+    //remaining words go into the first lane
+    for (; i < num; i++) { memcpy(w, data + i, sizeof(uint32_t)); h[0] = (h[0] ^ w[0])*0x9E3779B97F4A7C15ull; h[0] ^= h[0] >> 32; }
+    //merge lanes along with the number of words
+    uint64_t r = num;
+    for (int k = 0; k < 4; k++) { r = (r ^ h[k])*0xC2B2AE3D27D4EB4Full; r ^= r >> 31; }
+    return r;
+}
+static float atmxPCM (const void* data, uint8_t format, int32_t i) {
+    //integer value of sample i in given format as float, unsigned 8-bit centered on zero
+    const uint8_t* b = (const uint8_t*)data;
+    if (format == ATOMIX_U8) return (float)b[i] - 128.0f;
+    if (format == ATOMIX_S16) { int16_t v; memcpy(&v, b + (size_t)i*2, sizeof(v)); return (float)v; }
+    //24-bit little-endian shifted into the top of 32 bits and arithmetically back down to sign extend
+    b += (size_t)i*3;
+    return (float)((int32_t)((uint32_t)b[0] << 8 | (uint32_t)b[1] << 16 | (uint32_t)b[2] << 24) >> 8);
+}
+static float atmxPCMScale (uint8_t format) {
+    //factor bringing full scale of given format to 1
+    return (format == ATOMIX_U8) ? 1.0f/128.0f : (format == ATOMIX_S16) ? 1.0f/32768.0f : 1.0f/8388608.0f;
+}
+static uint8_t atmxSoundChannels (uint8_t cha, float* data, int32_t len, uint8_t flags) {
+    //keep channels unless asked to collapse stereo
+    if ((cha != 2)||(!(flags & ATOMIX_MONO))) return cha;
+    //compare left and right of every frame, 4 frames at a time using SSE, stopping at the first difference
+    int32_t i = 0;
+    #ifndef ATOMIX_NO_SSE
+        __m128 tol = _mm_set_ps1(ATOMIX_MONO_TOL), zero = _mm_setzero_ps();
+        for (; i + 4 <= len; i += 4) {
+            //difference of each sample to its neighbour in the same frame, swapped with a shuffle
+            __m128 a = _mm_loadu_ps(data + i*2), b = _mm_loadu_ps(data + i*2 + 4);
+            __m128 da = _mm_sub_ps(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)));
+            __m128 db = _mm_sub_ps(b, _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 3, 0, 1)));
+            //absolute value as maximum with negation, compared against the tolerance
+            __m128 far = _mm_or_ps(_mm_cmpgt_ps(_mm_max_ps(da, _mm_sub_ps(zero, da)), tol), _mm_cmpgt_ps(_mm_max_ps(db, _mm_sub_ps(zero, db)), tol));
+            if (_mm_movemask_ps(far)) return 2;
+        }
+    #endif
+    //remaining frames (all without SSE) one at a time
+    for (; i < len; i++) if (fabsf(data[i*2] - data[i*2+1]) > ATOMIX_MONO_TOL) return 2;
+    return 1;
+}
+static int atmxSoundSame (struct atomix_sound* snd, float* data, int32_t len, uint8_t cha) {
+    //stored data must be identical, or the average of left and right if stereo collapsed to mono
+    float* sdat = (float*)snd->data;
+    if (cha == snd->cha) { if (memcmp(sdat, data, (size_t)len*cha*sizeof(float))) return 0; }
+    else for (int32_t i = 0; i < len; i++) if (sdat[i] != (data[i*2] + data[i*2+1])*0.5f) return 0;
+    //and the rest must be padding
+    for (int32_t i = len*snd->cha; i < snd->len*snd->cha; i++) if (sdat[i] != 0.0f) return 0;
+    return 1;
+}
 static struct atmx_f2 atmxGainf2 (float gain, float pan) {
     //clamp pan to its valid range of -1.0f to 1.0f inclusive
     pan = (pan < -1.0f) ? -1.0f : (pan > 1.0f) ? 1.0f : pan;
     //convert gain and pan to left and right gain and store it atomically
     return (struct atmx_f2){gain*(0.5f - pan/2.0f), gain*(0.5f + pan/2.0f)};
 }
+static uint32_t atmxMix (struct atomix_mixer* mix, float* buff, uint32_t fnum) {
+    //the mixing function differs greatly depending on whether SSE is enabled or not
+    #ifndef ATOMIX_NO_SSE
+        //output remaining frames in buffer before mixing new ones
+        uint32_t rnum = fnum;
+        //only do this if there are old frames
+        if (mix->rem)
+            if (rnum > mix->rem) {
+                //rnum bigger than remaining frames (usual case)
+                memcpy(buff, mix->data, mix->rem*2*sizeof(float));
+                rnum -= mix->rem; buff += mix->rem*2; mix->rem = 0;
+            } else {
+                //rnum smaller equal remaining frames (rare case)
+                memcpy(buff, mix->data, rnum*2*sizeof(float)); mix->rem -= rnum;
+                //move back remaining old frames if any
+                if (mix->rem) memmove(mix->data, mix->data + rnum*2, (3 - rnum)*2*sizeof(float));
+                //return
+                return fnum;
+            }
+        //start the clock if under a time budget
+        uint32_t budget = ATMX_LOAD(&mix->budget); uint64_t clk = budget ? ATOMIX_CLOCK() : 0;
+        //asize in __m128 (__m128 = 2 frames) and multiple of 2
+        uint32_t asize = ((rnum + 3) & ~3) >> 1;
+        //dynamically sized aligned buffer
+        __m128 align[asize];
+        //clear the aligned buffer using SSE assignment
+        for (uint32_t i = 0; i < asize; i++) align[i] = _mm_setzero_ps();
+        //begin actual mixing, caching the volume first
+        __m128 vol = _mm_set_ps1(ATMX_LOAD(&mix->volume));
+        atmxMixSetup(mix);
+        //in mixing order, virtualizing the remaining active layers under a budget once the next one would not fit
+        int act = atmxMixOrder(mix), virt = 0; uint64_t vclk = 0;
+        atmxMixRates(mix, act);
+        for (int i = 0; i < act; i++) {
+            if (budget&&(!virt)&&atmxMixOver(mix, vclk = ATOMIX_CLOCK() - clk, budget, i, act)) virt = act - i;
+            atmxMixLayer(mix, &mix->lays[mix->order[i]], vol, align, asize, virt);
+        }
+        //mix mono voices still queued
+        if (mix->batch.num) atmxMixBatch(&mix->batch, align, asize);
+        if (budget) atmxMixStats(mix, ATOMIX_CLOCK() - clk, budget, virt, vclk);
+        //perform clipping using SSE min and max (unless disabled)
+        #ifndef ATOMIX_NO_CLIP
+            __m128 neg1 = _mm_set_ps1(-1.0f), pos1 = _mm_set_ps1(1.0f);
+            for (uint32_t i = 0; i < asize; i++) align[i] = _mm_min_ps(_mm_max_ps(align[i], neg1), pos1);
+        #endif
+        //copy rnum frames, leaving possible remainder
+        memcpy(buff, align, rnum*2*sizeof(float));
+        //determine remaining number of frames
+        mix->rem = asize*2 - rnum;
+        //copy remaining frames to buffer inside the mixer struct
+        if (mix->rem) memcpy(mix->data, (float*)align + rnum*2, mix->rem);
+    #else
+        //start the clock if under a time budget
+        uint32_t budget = ATMX_LOAD(&mix->budget); uint64_t clk = budget ? ATOMIX_CLOCK() : 0;
+        //clear the output buffer using memset
+        memset(buff, 0, fnum*2*sizeof(float));
+        //begin actual mixing, caching the volume first
+        float vol = ATMX_LOAD(&mix->volume);
+        atmxMixSetup(mix);
+        //in mixing order, virtualizing the remaining active layers under a budget once the next one would not fit
+        int act = atmxMixOrder(mix), virt = 0; uint64_t vclk = 0;
+        atmxMixRates(mix, act);
+        for (int i = 0; i < act; i++) {
+            if (budget&&(!virt)&&atmxMixOver(mix, vclk = ATOMIX_CLOCK() - clk, budget, i, act)) virt = act - i;
+            atmxMixLayer(mix, &mix->lays[mix->order[i]], vol, buff, fnum, virt);
+        }
+        if (budget) atmxMixStats(mix, ATOMIX_CLOCK() - clk, budget, virt, vclk);
+        //perform clipping using simple ternary operators (unless disabled)
+        #ifndef ATOMIX_NO_CLIP
+            for (uint32_t i = 0; i < fnum*2; i++) buff[i] = (buff[i] < -1.0f) ? -1.0f : (buff[i] > 1.0f) ? 1.0f : buff[i];
+        #endif
+    #endif
+    //return
+    return fnum;
+}
+static void atmxLayerInit (struct atomix_mixer* mix, struct atmx_layer* lay, uint32_t id, struct atomix_sound* snd, uint8_t flag, float gain, float pan, int32_t start, int32_t end, int32_t fade) {
+    //fill in non-atomic layer data along with truncating start and end
+    lay->id = id; lay->snd = snd;
+    lay->start = start & ~3; lay->end = end & ~3;
+    //looping sounds play on to the end of the sound (or the given end if further) when leaving the loop
+    lay->tail = (lay->end > snd->len) ? lay->end : snd->len; lay->lend = lay->end;
+    ATMX_STORE(&lay->loops, -1); ATMX_STORE(&lay->prio, (uint8_t)0);
+    lay->fmax = (fade < 0) ? 0 : fade & ~3;
+    //set initial fade state based on flag
+    lay->fade = (flag < 3) ? 0 : lay->fmax;
+    //convert gain and pan to left and right gain and store it atomically
+    ATMX_STORE(&lay->gain, atmxGainf2(gain, pan));
+    //sounds start out non-positional
+    for (int j = 0; j < 3; j++) { ATMX_STORE(&lay->dir[j], 0.0f); ATMX_STORE(&lay->vel[j], 0.0f); }
+    lay->bin.on = 0; lay->rate = 1.0f; lay->frac = 0.0f;
+    ATMX_STORE(&lay->pitch, 1.0f);
+    ATMX_STORE(&lay->uni, (uint8_t)1); ATMX_STORE(&lay->udet, 0.0f); ATMX_STORE(&lay->uspr, 0.0f);
+    lay->unis.on = 0;
+    ATMX_STORE(&lay->gsize, 0); lay->gran.on = 0; lay->gran.seed = id*2654435761u;
+    //atomically set cursor to start position based on given argument
+    ATMX_STORE(&lay->cursor, lay->start);
+    //store flag last, releasing the layer to the mixer thread, then flag it as started for the mixing order
+    ATMX_STORE(&lay->flag, flag);
+    int i = (int)(lay - mix->lays);
+    atomic_fetch_or_explicit(&mix->fresh[i >> 5], (uint32_t)1 << (i & 31), memory_order_release);
+}
+static float atmxLayerCost (struct atomix_mixer* mix, struct atmx_layer* lay) {
+    //inactive and halted layers cost next to nothing
+    uint8_t flag = ATMX_LOAD(&lay->flag);
+    if (flag < 2) return 0.0f;
+    //the path is decided as in the mixer, granular by grains alive at once, then unison by voices
+    int32_t size = ATMX_LOAD(&lay->gsize);
+    if (size > 0) {
+        float grains = (float)size/(float)ATMX_LOAD(&lay->gival);
+        return mix->cost[6] + mix->cost[7]*((grains < 1.0f) ? 1.0f : (grains > ATMX_GRAINS) ? ATMX_GRAINS : grains);
+    }
+    int uni = ATMX_LOAD(&lay->uni);
+    if (uni > 1) return mix->cost[4] + mix->cost[5]*(float)atmxUnisonWidth(uni);
+    //then binaural if positional and enabled, pitched if pitched or moving, and plain otherwise
+    float pos = 0.0f, vel = 0.0f;
+    for (int j = 0; j < 3; j++) { pos += fabsf(ATMX_LOAD(&lay->dir[j])); vel += fabsf(ATMX_LOAD(&lay->vel[j])); }
+    if ((pos > 0.0f)&&(ATMX_LOAD(&mix->brate) > 0)) return mix->cost[3];
+    if ((ATMX_LOAD(&lay->pitch) != 1.0f)||((pos > 0.0f)&&(vel > 0.0f))) return mix->cost[2];
+    return mix->cost[(lay->snd->cha == 1) ? 0 : 1];
+}
+static int atmxUnisonWidth (int uni) {
+    //unison voices are mixed 4 at a time with SSE, so their cost grows by groups of 4
+    #ifndef ATOMIX_NO_SSE
+        return (uni + 3) >> 2;
+    #else
+        return uni;
+    #endif
+}
+static float atmxCalibrate (struct atomix_mixer* tmp, struct atomix_sound* snd, int path) {
+    //reset scratch mixer, then fill 8 looping layers taking given path (none for the mix itself)
+    for (int i = 0; i < ATMX_LAYERS; i++) ATMX_STORE(&tmp->lays[i].flag, (uint8_t)0);
+    ATMX_STORE(&tmp->brate, (path == 3) ? 48000 : 0);
+    for (int i = 0; (i < 8)&&(path < 8); i++) {
+        struct atmx_layer* lay = &tmp->lays[i];
+        atmxLayerInit(tmp, lay, (uint32_t)(i + 1), snd, ATOMIX_LOOP, 1.0f/8.0f, 0.0f, 0, snd->len, 0);
+        if (path == 2) ATMX_STORE(&lay->pitch, 1.5f);
+        if (path == 3) ATMX_STORE(&lay->dir[0], 1.0f);
+        if ((path == 4)||(path == 5)) {
+            ATMX_STORE(&lay->udet, 0.1f); ATMX_STORE(&lay->uspr, 1.0f);
+            ATMX_STORE(&lay->uni, (uint8_t)((path == 4) ? 2 : 8));
+        }
+        if ((path == 6)||(path == 7)) {
+            ATMX_STORE(&lay->gival, (path == 6) ? 512 : 128); ATMX_STORE(&lay->gscat, 1024);
+            ATMX_STORE(&lay->gpit, 0.1f); ATMX_STORE(&lay->gspr, 1.0f);
+            ATMX_STORE(&lay->gsize, 2048);
+        }
+    }
+    //mix 1024 frames a few times to warm up and let grains spawn, then keep the fastest of the following runs
+    float buff[2048]; uint64_t best = ~(uint64_t)0;
+    for (int i = 0; i < 6; i++) {
+        uint64_t clk = ATOMIX_CLOCK();
+        atmxMix(tmp, buff, 1024);
+        clk = ATOMIX_CLOCK() - clk;
+        if ((i >= 3)&&(clk < best)) best = clk;
+    }
+    //return
+    return (float)best;
+}
+static void atmxMixSetup (struct atomix_mixer* mix) {
+    //atomically load listener orientation
+    float yaw = ATMX_LOAD(&mix->lis[0]), pitch = ATMX_LOAD(&mix->lis[1]), roll = ATMX_LOAD(&mix->lis[2]);
+    //rotate the left axis by roll, then pitch, then yaw
+    float lx = -sinf(pitch)*sinf(roll), ly = cosf(roll), lz = cosf(pitch)*sinf(roll);
+    mix->left[0] = lx*cosf(yaw) - ly*sinf(yaw);
+    mix->left[1] = lx*sinf(yaw) + ly*cosf(yaw);
+    mix->left[2] = lz;
+    //atomically load binaural sample rate and derive head radius in frames and bilinear transform constants
+    float rate = (float)ATMX_LOAD(&mix->brate);
+    mix->bhead = ATMX_BHEAD/ATMX_SPEED*rate;
+    mix->bk = 2.0f*rate; mix->bt = 2.0f*ATMX_SPEED/ATMX_BHEAD;
+    mix->ba1 = (mix->bt - mix->bk)/(mix->bt + mix->bk);
+}
+static int atmxMixOrder (struct atomix_mixer* mix) {
+    //rekey the layers listed in the previous mix, dropping those cleared since
+    struct atmx_okey* key = mix->okey; int act = 0;
+    for (int i = 0; i < mix->act; i++) {
+        uint16_t o = mix->order[i]; struct atmx_layer* lay = &mix->lays[o];
+        if (!ATMX_LOAD(&lay->flag)) { lay->listed = 0; continue; }
+        atmxMixKey(lay, &key[o]); mix->order[act++] = o;
+    }
+    //insertion sort of the order of the previous mix, which is nearly sorted already
+    for (int i = 1; i < act; i++) {
+        uint16_t o = mix->order[i]; int j = i;
+        for (; (j > 0)&&atmxMixBefore(&key[o], &key[mix->order[j-1]]); j--) mix->order[j] = mix->order[j-1];
+        mix->order[j] = o;
+    }
+    //atomically take the layers started since, inserting each at its place found by binary search
+    //a layer reused before its previous use was dropped is listed already and only rekeyed above
+    for (int w = 0; w < ATMX_FRESH; w++) {
+        uint32_t bits = atomic_exchange_explicit(&mix->fresh[w], (uint32_t)0, memory_order_acquire);
+        for (int b = 0; bits; b++, bits >>= 1) {
+            uint16_t o = (uint16_t)(w*32 + b); struct atmx_layer* lay = &mix->lays[o];
+            if ((!(bits & 1))||lay->listed||(!ATMX_LOAD(&lay->flag))) continue;
+            atmxMixKey(lay, &key[o]);
+            int lo = 0, hi = act;
+            while (lo < hi) {
+                int mid = (lo + hi) >> 1;
+                if (atmxMixBefore(&key[o], &key[mix->order[mid]])) hi = mid; else lo = mid + 1;
+            }
+            memmove(&mix->order[lo + 1], &mix->order[lo], (act - lo)*sizeof(uint16_t));
+            mix->order[lo] = o; lay->listed = 1; act++;
+        }
+    }
+    //return number of listed layers
+    return (mix->act = act);
+}
+static void atmxMixKey (struct atmx_layer* lay, struct atmx_okey* key) {
+    //key by priority, sound, and cursor
+    key->rank = (uint16_t)(255 - ATMX_LOAD(&lay->prio));
+    key->snd = (uintptr_t)(void*)lay->snd; key->cur = ATMX_LOAD(&lay->cursor);
+}
+static int atmxMixBefore (struct atmx_okey* a, struct atmx_okey* b) {
+    //compare priority first, then sound, then cursor
+    if (a->rank != b->rank) return (a->rank < b->rank);
+    if (a->snd != b->snd) return (a->snd < b->snd);
+    return (a->cur < b->cur);
+}
+static int atmxMixOver (struct atomix_mixer* mix, uint64_t elapsed, uint32_t budget, int done, int act) {
+    //mono voices queued but not yet mixed are charged the average too, as they are mixed at the end regardless
+    int queued = 0;
+    #ifndef ATOMIX_NO_SSE
+        queued = mix->batch.num; done -= queued;
+    #endif
+    //nearly spent if another layer costing the average so far would no longer fit into 15/16 of the budget
+    //together with virtualizing the layers after it, the rest is left for clipping
+    uint64_t lim = budget - budget/16, rest = (uint64_t)mix->vcost*(uint64_t)(act - done - queued - 1);
+    if (elapsed + rest >= lim) return 1;
+    return done ? (elapsed + rest + elapsed*(uint64_t)(queued + 1)/(uint64_t)done > lim) : 0;
+}
+static void atmxMixStats (struct atomix_mixer* mix, uint64_t elapsed, uint32_t budget, int virt, uint64_t vclk) {
+    //follow the cost of virtualizing a layer, which includes mixing the queued mono voices
+    if (virt) mix->vcost = (uint32_t)((3*(uint64_t)mix->vcost + (elapsed - vclk)/(uint64_t)virt)/4);
+    //relaxed atomic additions, as the control thread may reset them meanwhile
+    atomic_fetch_add_explicit(&mix->stats[0], (uint64_t)1, memory_order_relaxed);
+    if (virt) atomic_fetch_add_explicit(&mix->stats[1], (uint64_t)1, memory_order_relaxed);
+    if (virt) atomic_fetch_add_explicit(&mix->stats[2], (uint64_t)virt, memory_order_relaxed);
+    if (elapsed > budget) atomic_fetch_add_explicit(&mix->stats[3], (uint64_t)1, memory_order_relaxed);
+}
+static int32_t atmxMixSkip (struct atmx_layer* lay, uint8_t flag, int32_t cur, float rate, uint32_t fnum, int32_t step) {
+    //cache cursor and determine what to do with it
+    int32_t old = cur; int mode = atmxMixMode(lay, flag, cur, rate), loop = (flag == ATOMIX_LOOP);
+    //per frame step that reaches the target rate at the end of this mix
+    float ramp = atmxMixRate(lay, rate, (float)fnum);
+    for (uint32_t i = 0, n; i < fnum; i += n) {
+        //quit if faded out or at end, wrapping around if looping
+        if (atmxMixBegin(lay, mode, &loop, &cur) < 0.0f) break;
+        //jump as far as possible at once, up to the end of the fade or the sound (kept in whole steps)
+        int32_t left = (int32_t)(fnum - i);
+        if ((mode == 1)&&(lay->fmax - lay->fade < left)) left = lay->fmax - lay->fade;
+        if ((mode == 2)&&(lay->fade < left)) left = lay->fade;
+        float ends = ((float)(lay->end - cur) - lay->frac)/lay->rate;
+        if (ends < (float)left) left = (int32_t)ends;
+        n = (left > step) ? (uint32_t)(left - left % step) : (uint32_t)step;
+        //position after n frames of a linearly ramping rate, passing whole steps as the pitched kernels would
+        float pos = lay->frac + (float)n*lay->rate + ramp*0.5f*(float)n*(float)(n + 1);
+        lay->rate += ramp*(float)n;
+        int32_t adv = (int32_t)pos - (int32_t)pos % step; lay->frac = pos - (float)adv;
+        //advance fade and cursor
+        atmxMixAdvance(lay, mode, &cur, (int32_t)n, adv);
+    }
+    //never leave the cursor past the end, so that regular kernels can take over
+    atmxMixWrap(lay, mode, &loop, &cur);
+    //swap back cursor if unchanged
+    if (!ATMX_CSWAP(&lay->cursor, &old, cur)) cur = old;
+    //return new cursor
+    return cur;
+}
+static int atmxDirection (struct atomix_mixer* mix, struct atmx_layer* lay, float* dot) {
+    //atomically load direction and return 0 if not positional
+    float x = ATMX_LOAD(&lay->dir[0]), y = ATMX_LOAD(&lay->dir[1]), z = ATMX_LOAD(&lay->dir[2]);
+    if ((x == 0.0f)&&(y == 0.0f)&&(z == 0.0f)) return 0;
+    //B-format gains are (1, x, y, z), the left and right cardioids are 0.5*(1, +-left) in that format
+    //so their product with the encoding gains is a pan equal to the dot product of direction and left axis
+    *dot = x*mix->left[0] + y*mix->left[1] + z*mix->left[2];
+    *dot = (*dot < -1.0f) ? -1.0f : (*dot > 1.0f) ? 1.0f : *dot;
+    return 1;
+}
+static int atmxMixMode (struct atmx_layer* lay, uint8_t flag, int32_t cur, float rate) {
+    //ATOMIX_PLAY or ATOMIX_LOOP, 1 if fading in or 0 if not
+    if (flag > 2) return (lay->fade < lay->fmax);
+    //ATOMIX_STOP or ATOMIX_HALT, 2 if enough samples left for fade out or 3 to play to end
+    //the fade counts output frames, so pitched sounds compare it to the samples they will read meanwhile
+    return ((float)lay->fade*rate < (float)(lay->end - cur)) ? 2 : 3;
+}
+static float atmxMixBegin (struct atmx_layer* lay, int mode, int* loop, int32_t* cur) {
+    //quit if fully faded out or at end, wrapping around if looping
+    if ((mode == 2)&&(lay->fade == 0)) return -1.0f;
+    if (!atmxMixWrap(lay, mode, loop, cur)) return -1.0f;
+    //return fade multiplier
+    return ((mode == 1)||(mode == 2)) ? (float)lay->fade/(float)lay->fmax : 1.0f;
+}
+static int atmxMixWrap (struct atmx_layer* lay, int mode, int* loop, int32_t* cur) {
+    //pitched sounds can step past the end, which is otherwise only reached exactly when not fading out
+    if (*cur < lay->end) return 1;
+    //stop at the end unless looping (never when fading out or playing to end)
+    int32_t over = *cur - lay->end;
+    if ((mode > 1)||(!atmxMixLoop(lay, loop, cur))) { *cur = lay->end; return 0; }
+    //keep any overshoot if wrapped around
+    if (*loop) { *cur += over; if (*cur >= lay->end) *cur = lay->start; }
+    return 1;
+}
+static int atmxMixLoop (struct atmx_layer* lay, int* loop, int32_t* cur) {
+    //quit at the end unless looping
+    if (!*loop) return 0;
+    //atomically count down remaining loops unless negative (looping forever), retrying if changed meanwhile
+    int32_t n = ATMX_LOAD(&lay->loops);
+    while ((n > 0)&&(!ATMX_CSWAP(&lay->loops, &n, n - 1)));
+    //wrap around unless the loop ran out
+    if (n != 0) { *cur = lay->start; return 1; }
+    //otherwise move on to the tail after the loop, playing it to its end if there is one
+    *loop = 0; lay->end = lay->tail;
+    return (*cur < lay->end);
+}
+static void atmxMixAdvance (struct atmx_layer* lay, int mode, int32_t* cur, int32_t fstep, int32_t cstep) {
+    //advance fade in unless fully faded in, or fade out
+    if ((mode == 1)&&(lay->fade < lay->fmax)) lay->fade += fstep;
+    if (mode == 2) lay->fade -= fstep;
+    //advance cursor
+    *cur += cstep;
+}
+static int atmxPitched (struct atmx_layer* lay, float rate) {
+    //pitched while the target or current rate differs from the original rate
+    return (rate != 1.0f)||(lay->rate != 1.0f);
+}
+static float atmxMixRate (struct atmx_layer* lay, float rate, float n) {
+    //snap to the target rate when close enough so that voices can return to the regular kernels
+    if (fabsf(rate - lay->rate) < 1e-6f) lay->rate = rate;
+    //return the per frame step that reaches the target rate after n frames
+    return (rate - lay->rate)/n;
+}
+static int atmxMixLevel (struct atomix_sound* snd, float rate) {
+    //original data unless pitched up by at least an octave and mipmapped
+    if ((rate < 2.0f)||(!snd->mip[0])) return 0;
+    //half rate data unless pitched up by two octaves
+    return (rate < 4.0f) ? 1 : 2;
+}
+static void atmxMixFrame (struct atomix_sound* snd, int lev, int32_t idx, float* l, float* r) {
+    //silence before the start of the sound
+    if (idx < 0) { *l = *r = 0.0f; return; }
+    //load left and right of the frame from the mipmap level, which are the same sample for mono
+    float* data = lev ? snd->mip[lev-1] : (float*)snd->data; int32_t len = snd->len >> lev;
+    if (idx >= len) idx %= len;
+    if (snd->cha == 1) *l = *r = data[idx];
+    else { *l = data[idx*2]; *r = data[idx*2+1]; }
+}
+static void atmxMixRates (struct atomix_mixer* mix, int act) {
+    //pitch alone for active layers at rest, gathering moving ones, which are few, into a compact list
+    uint16_t mov[ATMX_LAYERS]; int num = 0, i = 0;
+    for (int k = 0; k < act; k++) {
+        struct atmx_layer* lay = &mix->lays[mix->order[k]];
+        lay->trate = ATMX_LOAD(&lay->pitch);
+        if ((ATMX_LOAD(&lay->vel[0]) != 0.0f)||(ATMX_LOAD(&lay->vel[1]) != 0.0f)||(ATMX_LOAD(&lay->vel[2]) != 0.0f))
+            mov[num++] = mix->order[k];
+    }
+    //Doppler shift of moving layers 4 at a time using SSE
+    #ifndef ATOMIX_NO_SSE
+        __m128 c = _mm_set_ps1(ATMX_SPEED), cmin = _mm_set_ps1(ATMX_SPEED*0.25f), cmax = _mm_set_ps1(ATMX_SPEED*4.0f);
+        __m128 rmin = _mm_set_ps1(0.25f), rmax = _mm_set_ps1(4.0f), zero = _mm_setzero_ps();
+        for (; i + 4 <= num; i += 4) {
+            //gather velocity, direction, and pitch of 4 layers
+            float v[7][4], r[4];
+            for (int k = 0; k < 4; k++) {
+                struct atmx_layer* lay = &mix->lays[mov[i+k]];
+                for (int j = 0; j < 3; j++) { v[j][k] = ATMX_LOAD(&lay->vel[j]); v[j+3][k] = ATMX_LOAD(&lay->dir[j]); }
+                v[6][k] = lay->trate;
+            }
+            //radial velocity, observed rate, pitch, and clamping as in atmxRate
+            __m128 pit = _mm_loadu_ps(v[6]), vr = _mm_mul_ps(_mm_loadu_ps(v[0]), _mm_loadu_ps(v[3]));
+            vr = _mm_add_ps(vr, _mm_mul_ps(_mm_loadu_ps(v[1]), _mm_loadu_ps(v[4])));
+            vr = _mm_add_ps(vr, _mm_mul_ps(_mm_loadu_ps(v[2]), _mm_loadu_ps(v[5])));
+            __m128 still = _mm_cmpeq_ps(vr, zero);
+            vr = _mm_min_ps(_mm_max_ps(_mm_add_ps(c, vr), cmin), cmax);
+            vr = _mm_min_ps(_mm_max_ps(_mm_div_ps(_mm_mul_ps(pit, c), vr), rmin), rmax);
+            //the pitch exactly where not moving towards or away from the listener, like non-positional layers
+            _mm_storeu_ps(r, _mm_or_ps(_mm_and_ps(still, pit), _mm_andnot_ps(still, vr)));
+            for (int k = 0; k < 4; k++) mix->lays[mov[i+k]].trate = r[k];
+        }
+    #endif
+    //remaining moving layers (all without SSE) one at a time
+    for (; i < num; i++) mix->lays[mov[i]].trate = atmxRate(&mix->lays[mov[i]]);
+}
+static float atmxRate (struct atmx_layer* lay) {
+    //pitch of this mix, which is the rate unless moving towards or away from the listener
+    float pitch = lay->trate, vr = 0.0f;
+    //radial velocity away from the listener, which is zero if not positional
+    for (int j = 0; j < 3; j++) vr += ATMX_LOAD(&lay->vel[j])*ATMX_LOAD(&lay->dir[j]);
+    if (vr == 0.0f) return pitch;
+    //observed rate for a listener at rest, clamped to two octaves either way
+    vr = ATMX_SPEED + vr;
+    vr = (vr < ATMX_SPEED*0.25f) ? ATMX_SPEED*0.25f : (vr > ATMX_SPEED*4.0f) ? ATMX_SPEED*4.0f : vr;
+    //multiplied with the pitch and clamped again
+    vr = pitch*ATMX_SPEED/vr;
+    return (vr < 0.25f) ? 0.25f : (vr > 4.0f) ? 4.0f : vr;
+}
+static float atmxUnisonSetup (struct atmx_layer* lay, int uni, struct atmx_f2 g, float* dm, float* gl, float* gr) {
+    //atomically load detune and spread
+    float det = ATMX_LOAD(&lay->udet), spr = ATMX_LOAD(&lay->uspr);
+    //start copies staggered by a few milliseconds if state is not current, to avoid phasing
+    if (!lay->unis.on) {
+        for (int j = 0; j < ATMX_UNISON; j++) lay->unis.off[j] = -31.0f*(float)j;
+        lay->unis.on = 1;
+    }
+    //pan of the sound itself, and gain normalized for the power sum of uncorrelated copies
+    float gain = g.l + g.r, pan = (gain != 0.0f) ? (g.r - g.l)/gain : 0.0f;
+    gain /= sqrtf((float)uni);
+    //spread copies evenly from -1 to 1, padding with silent copies
+    for (int j = 0; j < ATMX_UNISON; j++) {
+        float x = (j < uni) ? 2.0f*(float)j/(float)(uni - 1) - 1.0f : 0.0f;
+        struct atmx_f2 cg = atmxGainf2((j < uni) ? gain : 0.0f, pan + spr*x);
+        dm[j] = det*x; gl[j] = cg.l; gr[j] = cg.r;
+        //keep copies of looping sounds within one loop of the center
+        if (lay->end > lay->start) lay->unis.off[j] = fmodf(lay->unis.off[j], (float)(lay->end - lay->start));
+    }
+    //return the largest rate multiplier among copies
+    return 1.0f + det;
+}
+static void atmxMixRange (struct atmx_layer* lay, int lev, int loop, int32_t cur, int32_t* lo, int32_t* hi) {
+    //indices from the loop start (or 0) to the end (or sound length) never need wrapping or silence
+    *lo = (loop&&(cur >= lay->start)&&(lay->start > 0)) ? lay->start >> lev : 0;
+    *hi = ((lay->end < lay->snd->len) ? lay->end : lay->snd->len) >> lev;
+}
+static void atmxMixTap (struct atmx_layer* lay, float* data, int cha, int lev, int loop, int32_t cur, int32_t lo, int32_t hi, float p, float* tap) {
+    //split position relative to the cursor at the mipmap level, rounding down for copies behind it
+    int32_t ipos = (int32_t)p; ipos -= (p < (float)ipos); tap[0] = p - (float)ipos;
+    int32_t idx = (cur >> lev) + ipos;
+    if ((idx >= lo)&&(idx + 1 < hi)) {
+        //common case reading left and right of both neighbours, right being the same sample as left for mono
+        float* d = data + idx*cha;
+        tap[1] = d[0]; tap[2] = d[cha-1]; tap[3] = d[cha]; tap[4] = d[2*cha-1];
+    } else {
+        //otherwise wrap around loops or read silence
+        float l, r;
+        atmxMixFrame(lay->snd, lev, atmxLoopIndex(lay, lev, loop, cur, idx), &l, &r); tap[1] = l; tap[2] = r;
+        atmxMixFrame(lay->snd, lev, atmxLoopIndex(lay, lev, loop, cur, idx + 1), &l, &r); tap[3] = l; tap[4] = r;
+    }
+}
+static int32_t atmxLoopIndex (struct atmx_layer* lay, int lev, int loop, int32_t cur, int32_t idx) {
+    //copies of sounds that do not loop are silent past the end, indices are at the mipmap level
+    int32_t start = lay->start >> lev, end = lay->end >> lev;
+    if (!loop) return (idx < end) ? idx : -1;
+    //only looping sounds past their start wrap around
+    if ((end <= start)||(cur < lay->start)||((idx >= start)&&(idx < end))) return idx;
+    //wrap into the loop
+    int32_t d = (idx - start) % (end - start);
+    return start + ((d < 0) ? d + (end - start) : d);
+}
+static float atmxGrainSetup (struct atmx_layer* lay, struct atmx_f2 g) {
+    //atomically load grain parameters, a torn set only affects a single mix
+    struct atmx_granular* gs = &lay->gran;
+    gs->size = ATMX_LOAD(&lay->gsize); gs->ival = ATMX_LOAD(&lay->gival); gs->scat = ATMX_LOAD(&lay->gscat);
+    gs->pit = ATMX_LOAD(&lay->gpit); gs->spr = ATMX_LOAD(&lay->gspr);
+    if (gs->size < 4) gs->size = 4;
+    if (gs->ival < 1) gs->ival = 1;
+    //start without grains if state is not current, spawning the first one right away
+    if (!gs->on) {
+        for (int j = 0; j < ATMX_GRAINS; j++) gs->ilen[j] = gs->gl[j] = gs->gr[j] = gs->rate[j] = 0.0f;
+        gs->next = 0; gs->on = 1;
+    }
+    //pan of the sound itself, and gain normalized for the power sum of overlapping uncorrelated grains
+    float gain = g.l + g.r, lap = (float)gs->size/(float)gs->ival;
+    gs->pan = (gain != 0.0f) ? (g.r - g.l)/gain : 0.0f;
+    gs->gain = (lap > 1.0f) ? gain/sqrtf(lap) : gain;
+    //return the largest rate multiplier among grains
+    return 1.0f + gs->pit;
+}
+static void atmxGrainTick (struct atmx_layer* lay, int loop, int32_t cur, float frac, float rate, int32_t n) {
+    //free grains that have played their full length, silencing them and keeping them in place
+    struct atmx_granular* gs = &lay->gran;
+    for (int j = 0; j < ATMX_GRAINS; j++)
+        if ((gs->ilen[j] > 0.0f)&&(gs->age[j] >= gs->len[j])) gs->ilen[j] = gs->gl[j] = gs->gr[j] = gs->rate[j] = 0.0f;
+    //spawn every grain due within the next n frames, intervals vary randomly from half to one and a half times
+    for (gs->next -= n; gs->next <= 0; gs->next += gs->ival + (int32_t)((float)gs->ival*0.5f*atmxGrainRandom(&gs->seed)))
+        atmxGrainSpawn(lay, loop, cur, frac, rate);
+}
+static void atmxGrainSpawn (struct atmx_layer* lay, int loop, int32_t cur, float frac, float rate) {
+    //random offset, rate, and pan, always drawn so that the sequence does not depend on free grains
+    struct atmx_granular* gs = &lay->gran;
+    float ro = atmxGrainRandom(&gs->seed), rr = atmxGrainRandom(&gs->seed), rp = atmxGrainRandom(&gs->seed);
+    //no grains within one grain of the end unless looping, as they would be cut off
+    if ((!loop)&&((float)(lay->end - cur) <= (float)gs->size*rate)) return;
+    //find a free grain, dropping the new one if all are playing
+    int j = 0;
+    while ((j < ATMX_GRAINS)&&(gs->ilen[j] > 0.0f)) j++;
+    if (j == ATMX_GRAINS) return;
+    //offset from the cursor, wrapped into the loop if looping
+    int32_t at = cur + (int32_t)(ro*(float)gs->scat), len = lay->end - lay->start;
+    if (loop&&(len > 0)&&(cur >= lay->start)&&((at < lay->start)||(at >= lay->end))) {
+        at = (at - lay->start) % len;
+        at = lay->start + ((at < 0) ? at + len : at);
+    }
+    //start at a multiple of 4 with the remainder and fractional cursor as position
+    gs->base[j] = at & ~3; gs->off[j] = (float)(at - gs->base[j]) + frac;
+    gs->rate[j] = rate*(1.0f + gs->pit*rr);
+    gs->age[j] = 0.0f; gs->len[j] = (float)gs->size; gs->ilen[j] = 1.0f/(float)gs->size;
+    struct atmx_f2 cg = atmxGainf2(gs->gain, gs->pan + gs->spr*rp);
+    gs->gl[j] = cg.l; gs->gr[j] = cg.r;
+}
+static float atmxGrainRandom (uint32_t* seed) {
+    //xorshift seeded from the handle, so that traces replay identically, scaled to -1 to 1
+    *seed ^= *seed << 13; *seed ^= *seed >> 17; *seed ^= *seed << 5;
+    return (float)(int32_t)*seed*(1.0f/2147483648.0f);
+}
+static void atmxDecimate (float* src, int32_t len, uint8_t cha, float* dst) {
+    //Blackman windowed sinc halfband filter, normalized to unity gain
+    float h[ATMX_MIPTAPS], sum = 0.0f; int c = ATMX_MIPTAPS/2;
+    for (int j = 0; j < ATMX_MIPTAPS; j++) {
+        float x = 3.14159265f*(float)(j - c)*0.5f, w = 6.28318531f*(float)j/(float)(ATMX_MIPTAPS - 1);
+        h[j] = ((j == c) ? 1.0f : sinf(x)/x)*(0.42f - 0.5f*cosf(w) + 0.08f*cosf(2.0f*w)); sum += h[j];
+    }
+    for (int j = 0; j < ATMX_MIPTAPS; j++) h[j] /= sum;
+    //filter every other frame of each channel, treating everything outside the data as silence
+    for (int32_t i = 0; i < len/2; i++)
+        for (int k = 0; k < cha; k++) {
+            float acc = 0.0f;
+            for (int j = 0; j < ATMX_MIPTAPS; j++) {
+                int32_t idx = 2*i + j - c;
+                if ((idx >= 0)&&(idx < len)) acc += h[j]*src[idx*cha + k];
+            }
+            dst[i*cha + k] = acc;
+        }
+}
+static void atmxBinauralTarget (struct atomix_mixer* mix, float dot, float* del, float* b0, float* b1) {
+    //incidence angles on left and right ear, which face along the left axis and against it
+    float inc[2] = {acosf(dot), acosf(-dot)};
+    for (int j = 0; j < 2; j++) {
+        //time delay of spherical head relative to the earliest possible arrival, clamped to delay line
+        del[j] = mix->bhead*((inc[j] < 1.5707963f) ? 1.0f - cosf(inc[j]) : 1.0f + inc[j] - 1.5707963f);
+        del[j] = (del[j] > ATMX_BHIST - 2) ? ATMX_BHIST - 2 : del[j];
+        //head shadow zero moves from 2 facing the source to 0.1 at 150 degrees, pole stays fixed
+        float alpha = 1.05f + 0.95f*cosf(inc[j]*1.2f);
+        b0[j] = (mix->bt + alpha*mix->bk)/(mix->bt + mix->bk);
+        b1[j] = (mix->bt - alpha*mix->bk)/(mix->bt + mix->bk);
+    }
+}
+#ifdef ATOMIX_PROFILE
+static void atmxProfile (struct atomix_sound* snd, uint64_t cycles, int fade, int wrap) {
+    //relaxed atomic additions as the same sound may be mixed by several mixers
+    atomic_fetch_add_explicit(&snd->prof[0], cycles, memory_order_relaxed);
+    atomic_fetch_add_explicit(&snd->prof[1], (uint64_t)1, memory_order_relaxed);
+    if (fade) atomic_fetch_add_explicit(&snd->prof[2], (uint64_t)1, memory_order_relaxed);
+    if (wrap) atomic_fetch_add_explicit(&snd->prof[3], (uint64_t)1, memory_order_relaxed);
+}
+#endif
+#ifdef ATOMIX_TRACE
+static void atmxTrace (struct atomix_mixer* mix, uint8_t type, uint8_t flag, uint32_t id, struct atomix_sound* snd, float gain, float pan, int32_t a, int32_t b, int32_t c, float x, float y, float z) {
+    //fill in event on the stack and pass it to the user hook
+    struct atomix_event evt = {type, flag, id, snd, gain, pan, a, b, c, x, y, z};
+    ATOMIX_TRACE(mix, &evt);
+}
+#endif
 
 #endif //ATOMIX_IMPLEMENTATION
\ No newline at end of file
@@ -1,5 +1,27 @@
 /*
 atomix.h example for command line usage like "test.exe mu.ogg so.ogg" performing benchmarks and demos
+Compile with "-DTEST_TRACE" and use "test.exe mu.ogg so.ogg record trace.bin" to record a trace of the demo instead
+of benchmarking, and "test.exe mu.ogg so.ogg replay trace.bin" to replay such a trace headless with per-callback timings.
+Use "test.exe mu.ogg so.ogg perf" to also read hardware performance counters during benchmarks (Linux only).
+Use "test.exe mu.ogg so.ogg kernels" to instead benchmark each mixing kernel in isolation on synthetic data.
+Compile with "-DATOMIX_PROFILE" to also print the per-sound cost attributed to the music by the benchmarks.
+Compile with "-DTEST_RTCHECK" (glibc only) and use "test.exe mu.ogg so.ogg rtcheck" to check that mixing never
+allocates, locks, or sleeps. Repeat with every configuration of interest, like "-DATOMIX_NO_SSE -DATOMIX_LBITS=4".
+Use "test.exe mu.ogg so.ogg stress" to measure mixing latency while another thread churns through control calls,
+checking that no layer gets stuck and no stop gets lost in the process.
+Use "test.exe mu.ogg so.ogg compare" to compare atomix against mixing miniaudio decoders by hand in the same scenes.
+Use "test.exe mu.ogg so.ogg budget" to check that a mixer given half the time it needs virtualizes low priority voices.
+Use "test.exe mu.ogg so.ogg estimate" to calibrate the cost model and compare its estimates against measured mixes.
+Use "test.exe mu.ogg so.ogg loops" to check that a sound released from its sustain loop can loop again.
+Use "test.exe mu.ogg so.ogg pitch" to check that voices ramped back to their original rate return to the regular kernels.
+Use "test.exe mu.ogg so.ogg dedup" to check that a sound registry shares sounds with identical content and how fast it hashes,
+also collapsing a dual-mono copy of the music to mono.
+Use "test.exe mu.ogg so.ogg formats" to check creating sounds from integer samples against converting them to floats first.
+Use "test.exe mu.ogg so.ogg resample" to check the quality and speed of resampling sounds to 48kHz at load time.
+Compile with "-DATOMIX_SHM" (POSIX only) and use "test.exe mu.ogg so.ogg bank" to check that a second process mixes
+identically from sounds it attached to through a shared memory bank instead of loading them itself.
+Compile with "-DATOMIX_MLOCK" (POSIX only) and use "test.exe mu.ogg so.ogg mlock" to check that sounds and mixers
+are locked into memory and unlocked when freed, and that mixing at real-time priority never faults a page.
 
 To the extent possible under law, the author(s) have dedicated all copyright and related and neighboring
 rights to this software to the public domain worldwide. This software is distributed without any warranty.
@@ -14,6 +36,11 @@ If you find an error in this test or discover a possible improvement, please ope
 */
 
 //includes
+#ifdef TEST_TRACE
+    struct atomix_mixer; struct atomix_event; //forward declarations for the trace hook
+    static void traceEvent(struct atomix_mixer*, struct atomix_event*);
+    #define ATOMIX_TRACE(M, E) traceEvent(M, E)
+#endif
 #define ATOMIX_STATIC
 #include "atomix.h"
 #define STB_VORBIS_NO_INTEGER_CONVERSION
@@ -24,6 +51,7 @@ If you find an error in this test or discover a possible improvement, please ope
 #include "libs/miniaudio.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 //data callback
 void dataCallback (ma_device* dev, void* out, const void* inp, ma_uint32 fnum) {
@@ -42,6 +70,14 @@ void dataCallback (ma_device* dev, void* out, const void* inp, ma_uint32 fnum) {
     void psleep (double s) {
         Sleep(s*1000.0);
     }
+    typedef HANDLE thread_t;
+    #define THREAD_FUNC(N) DWORD WINAPI N (void* arg)
+    void threadStart (thread_t* t, LPTHREAD_START_ROUTINE fn, void* arg) {
+        *t = CreateThread(NULL, 0, fn, arg, 0, NULL);
+    }
+    void threadJoin (thread_t t) {
+        WaitForSingleObject(t, INFINITE); CloseHandle(t);
+    }
 #else
     #include <sys/time.h>
     double getTime () {
@@ -50,56 +86,1220 @@ void dataCallback (ma_device* dev, void* out, const void* inp, ma_uint32 fnum) {
         return t.tv_sec + t.tv_usec*1e-6;
     }
     void psleep (double s) {
-        struct timespec t = {s, s*1e-6};
+        struct timespec t = {(time_t)s, (long)((s - (time_t)s)*1e9)};
         nanosleep(&t, NULL);
     }
+    #include <pthread.h>
+    typedef pthread_t thread_t;
+    #define THREAD_FUNC(N) void* N (void* arg)
+    void threadStart (thread_t* t, void* (*fn)(void*), void* arg) {
+        pthread_create(t, NULL, fn, arg);
+    }
+    void threadJoin (thread_t t) {
+        pthread_join(t, NULL);
+    }
+#endif
+
+//hardware performance counters
+#define PERF_NUM 5
+const char* perf_names[PERF_NUM] = {"cycles", "instructions", "L1D misses", "LLC misses", "branch misses"};
+uint64_t perf_vals[PERF_NUM]; //values of last measurement
+int perf_on; //counters requested and opened
+#ifdef __linux__
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+    int perf_fds[PERF_NUM];
+    int perfOpen () {
+        //counter types and configs matching perf_names
+        uint32_t types[PERF_NUM] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE};
+        uint64_t confs[PERF_NUM] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+            PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        //open all counters disabled for this thread in user mode only, some may be unsupported
+        int num = 0;
+        for (int i = 0; i < PERF_NUM; i++) {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr); attr.type = types[i]; attr.config = confs[i];
+            attr.disabled = 1; attr.exclude_kernel = 1; attr.exclude_hv = 1;
+            if ((perf_fds[i] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0)) >= 0) num++;
+        }
+        //fail only if no counter could be opened
+        return (num == 0);
+    }
+    void perfStart () {
+        //reset and enable all open counters
+        for (int i = 0; i < PERF_NUM; i++) if (perf_fds[i] >= 0) ioctl(perf_fds[i], PERF_EVENT_IOC_RESET, 0);
+        for (int i = 0; i < PERF_NUM; i++) if (perf_fds[i] >= 0) ioctl(perf_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+    void perfStop () {
+        //disable all open counters then read them, unavailable ones read as 0
+        for (int i = 0; i < PERF_NUM; i++) if (perf_fds[i] >= 0) ioctl(perf_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        for (int i = 0; i < PERF_NUM; i++)
+            if ((perf_fds[i] < 0)||(read(perf_fds[i], &perf_vals[i], sizeof(uint64_t)) != sizeof(uint64_t))) perf_vals[i] = 0;
+    }
+#else
+    int perfOpen () { return 1; }
+    void perfStart () {}
+    void perfStop () {}
+#endif
+void perfReport (double frames, double voices) {
+    //print counters per frame and per voice-frame if enabled
+    if (!perf_on) return;
+    for (int i = 0; i < PERF_NUM; i++)
+        printf("  %-14s %10.3f/frame %10.4f/voice\n", perf_names[i], perf_vals[i]/frames, perf_vals[i]/(frames*voices));
+}
+
+//cycle counting, falls back to nanoseconds where there is no time stamp counter
+#if defined(__x86_64__)||defined(__i386__)||defined(_M_X64)||defined(_M_IX86)
+    #ifdef _MSC_VER
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+    uint64_t getCycles () {
+        return __rdtsc();
+    }
+    void flushData (void* data, size_t size) {
+        //evict given range from all cache levels
+        for (size_t i = 0; i < size; i += 64) _mm_clflush((char*)data + i);
+        _mm_mfence();
+    }
+#else
+    uint64_t getCycles () {
+        return getTime()*1e9;
+    }
+    void flushData (void* data, size_t size) {}
+#endif
+
+//real-time safety checking by interposing allocation, locking, and sleeping functions
+#if defined(TEST_RTCHECK)&&defined(__GLIBC__)
+    #include <dlfcn.h>
+    #include <sched.h>
+    #include <semaphore.h>
+    #include <unistd.h>
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void __libc_free(void*);
+    _Thread_local int rt_mixing; //set while the checked thread is inside atomixMixerMix
+    _Atomic(int) rt_fails; //number of forbidden calls made while mixing
+    const char* _Atomic rt_last; //name of last forbidden call
+    static void rtForbid (const char* name) {
+        //count call if made while mixing, must not call anything interposed itself
+        if (!rt_mixing) return;
+        atomic_fetch_add(&rt_fails, 1); atomic_store(&rt_last, name);
+    }
+    #define RT_REAL(N) static __typeof__(&N) real; if (!real) real = (__typeof__(&N))dlsym(RTLD_NEXT, #N)
+    void* malloc (size_t size) { rtForbid("malloc"); return __libc_malloc(size); }
+    void* calloc (size_t num, size_t size) { rtForbid("calloc"); return __libc_calloc(num, size); }
+    void* realloc (void* ptr, size_t size) { rtForbid("realloc"); return __libc_realloc(ptr, size); }
+    void free (void* ptr) { rtForbid("free"); __libc_free(ptr); }
+    int pthread_mutex_lock (pthread_mutex_t* m) {
+        rtForbid("pthread_mutex_lock"); RT_REAL(pthread_mutex_lock); return real(m);
+    }
+    int pthread_mutex_trylock (pthread_mutex_t* m) {
+        rtForbid("pthread_mutex_trylock"); RT_REAL(pthread_mutex_trylock); return real(m);
+    }
+    int pthread_spin_lock (pthread_spinlock_t* l) {
+        rtForbid("pthread_spin_lock"); RT_REAL(pthread_spin_lock); return real(l);
+    }
+    int sem_wait (sem_t* s) {
+        rtForbid("sem_wait"); RT_REAL(sem_wait); return real(s);
+    }
+    int nanosleep (const struct timespec* t, struct timespec* r) {
+        rtForbid("nanosleep"); RT_REAL(nanosleep); return real(t, r);
+    }
+    int usleep (useconds_t u) {
+        rtForbid("usleep"); RT_REAL(usleep); return real(u);
+    }
+    int sched_yield () {
+        rtForbid("sched_yield"); RT_REAL(sched_yield); return real();
+    }
 #endif
 
+//trace recording
+#ifdef TEST_TRACE
+struct trace_rec {
+    uint32_t time; //microseconds since recording began
+    uint8_t type, flag, snd, pad; //event type, state flag, sound index
+    uint32_t id; //sound handle
+    float gain, pan; //gain and pan
+    int32_t a, b, c; //integer arguments
+    float x, y, z; //vector arguments
+};
+#define TRACE_MAX 1048576
+struct atomix_sound* trace_snds[2]; //sounds in load order
+struct trace_rec* trace_buff; //preallocated record buffer
+_Atomic(uint32_t) trace_num; //records written so far
+double trace_start; //time recording began
+static void traceEvent (struct atomix_mixer* mix, struct atomix_event* evt) {
+    //do nothing unless recording, records do not tell mixers apart
+    (void)mix;
+    if (!trace_buff) return;
+    //claim a record without locking, dropping events once full
+    uint32_t i = atomic_fetch_add(&trace_num, 1);
+    if (i >= TRACE_MAX) return;
+    //stamp and fill in record, mapping the sound pointer to its load index
+    struct trace_rec* rec = &trace_buff[i];
+    rec->time = (getTime() - trace_start)*1e6;
+    rec->type = evt->type; rec->flag = evt->flag; rec->id = evt->id;
+    rec->snd = (evt->snd == trace_snds[1]) ? 1 : 0;
+    rec->gain = evt->gain; rec->pan = evt->pan;
+    rec->a = evt->a; rec->b = evt->b; rec->c = evt->c;
+    rec->x = evt->x; rec->y = evt->y; rec->z = evt->z;
+}
+int traceWrite (const char* path) {
+    //write out all records that fit in the buffer
+    uint32_t num = atomic_load(&trace_num); if (num > TRACE_MAX) num = TRACE_MAX;
+    FILE* f = fopen(path, "wb"); if (!f) return 1;
+    fwrite(trace_buff, sizeof(struct trace_rec), num, f); fclose(f);
+    printf("Recorded %u events to %s\n", num, path);
+    return 0;
+}
+static int traceCompare (const void* a, const void* b) {
+    //compare doubles for qsort
+    return (*(double*)a > *(double*)b) - (*(double*)a < *(double*)b);
+}
+int traceReplay (const char* path) {
+    //read the whole trace into memory
+    FILE* f = fopen(path, "rb"); if (!f) return 1;
+    fseek(f, 0, SEEK_END); long num = ftell(f)/sizeof(struct trace_rec); fseek(f, 0, SEEK_SET);
+    struct trace_rec* recs = malloc(num*sizeof(struct trace_rec));
+    num = fread(recs, sizeof(struct trace_rec), num, f); fclose(f);
+    //timings for every mix callback, handle map from recorded to replayed handles
+    double* times = malloc(num*sizeof(double)); long tnum = 0; uint64_t frames = 0;
+    uint32_t rids[1 << ATOMIX_LBITS] = {0}, nids[1 << ATOMIX_LBITS] = {0};
+    float* buff = malloc(4096*2*sizeof(float)); uint32_t bmax = 4096;
+    struct atomix_mixer* mix = NULL;
+    //re-execute every call in recorded order as fast as possible
+    for (long i = 0; i < num; i++) {
+        struct trace_rec* r = &recs[i]; uint32_t id = nids[r->id & ((1 << ATOMIX_LBITS) - 1)];
+        if (rids[r->id & ((1 << ATOMIX_LBITS) - 1)] != r->id) id = 0;
+        if (r->type == ATOMIX_TRACE_NEW) { free(mix); mix = atomixMixerNew(r->gain, r->a); }
+        if (!mix) continue;
+        switch (r->type) {
+            case ATOMIX_TRACE_MIX: {
+                //grow output buffer if needed, then time the callback
+                if ((uint32_t)r->a > bmax) buff = realloc(buff, (bmax = r->a)*2*sizeof(float));
+                double start = getTime();
+                atomixMixerMix(mix, buff, r->a);
+                times[tnum++] = getTime() - start; frames += r->a;
+                break;
+            }
+            case ATOMIX_TRACE_PLAY:
+                //remember which handle the recorded handle maps to
+                id = atomixMixerPlayAdv(mix, trace_snds[r->snd], r->flag, r->gain, r->pan, r->a, r->b, r->c);
+                if (r->id) { rids[r->id & ((1 << ATOMIX_LBITS) - 1)] = r->id; nids[r->id & ((1 << ATOMIX_LBITS) - 1)] = id; }
+                break;
+            case ATOMIX_TRACE_GAINPAN: atomixMixerSetGainPan(mix, id, r->gain, r->pan); break;
+            case ATOMIX_TRACE_CURSOR: atomixMixerSetCursor(mix, id, r->a); break;
+            case ATOMIX_TRACE_STATE: atomixMixerSetState(mix, id, r->flag); break;
+            case ATOMIX_TRACE_DIRECTION: atomixMixerSetDirection(mix, id, r->x, r->y, r->z); break;
+            case ATOMIX_TRACE_VOLUME: atomixMixerVolume(mix, r->gain); break;
+            case ATOMIX_TRACE_LISTENER: atomixMixerListener(mix, r->x, r->y, r->z); break;
+            case ATOMIX_TRACE_BINAURAL: atomixMixerBinaural(mix, r->a); break;
+            case ATOMIX_TRACE_VELOCITY: atomixMixerSetVelocity(mix, id, r->x, r->y, r->z); break;
+            case ATOMIX_TRACE_PITCH: atomixMixerSetPitch(mix, id, r->gain); break;
+            case ATOMIX_TRACE_UNISON: atomixMixerSetUnison(mix, id, r->flag, r->x, r->y); break;
+            case ATOMIX_TRACE_GRANULAR: atomixMixerSetGranular(mix, id, r->a, r->b, r->c, r->x, r->y); break;
+            case ATOMIX_TRACE_LOOPS: atomixMixerSetLoops(mix, id, r->a); break;
+            case ATOMIX_TRACE_RELEASE: atomixMixerRelease(mix, id); break;
+            case ATOMIX_TRACE_PRIORITY: atomixMixerSetPriority(mix, id, r->flag); break;
+            case ATOMIX_TRACE_BUDGET: atomixMixerBudget(mix, (uint32_t)r->a); break;
+            case ATOMIX_TRACE_FADE: atomixMixerFade(mix, r->a); break;
+            case ATOMIX_TRACE_STOPALL: atomixMixerStopAll(mix); break;
+            case ATOMIX_TRACE_HALTALL: atomixMixerHaltAll(mix); break;
+            case ATOMIX_TRACE_PLAYALL: atomixMixerPlayAll(mix); break;
+        }
+    }
+    //report callback timing distribution
+    printf("<<REPLAY BEGIN>>\n");
+    if (tnum) {
+        double total = 0.0; for (long i = 0; i < tnum; i++) total += times[i];
+        qsort(times, tnum, sizeof(double), traceCompare);
+        printf("%ld events, %ld callbacks, %.0f frames/callback\n", num, tnum, (double)frames/tnum);
+        printf("min %.2fus avg %.2fus p50 %.2fus p99 %.2fus max %.2fus\n", times[0]*1e6, total/tnum*1e6,
+            times[tnum/2]*1e6, times[tnum*99/100]*1e6, times[tnum - 1]*1e6);
+        printf("%.0ff/s mixed overall\n", frames/total);
+    } else printf("No callbacks in trace!\n");
+    printf("<<REPLAY END>>\n");
+    //clean up
+    free(mix); free(buff); free(times); free(recs);
+    return 0;
+}
+#endif
+
+//benchmarking of the whole mixer
+void benchmark (struct atomix_mixer* mix, struct atomix_sound* mus) {
+    float bench_buff[1024];
+    printf("<<BENCHMARK BEGIN>>\n");
+    //mix 512 at a time 512 times with 256 sounds
+    for (int i = 0; i < 256; i++) atomixMixerPlay(mix, mus, ATOMIX_LOOP, 1.0f, 0.0f);
+    if (perf_on) perfStart();
+    double start = getTime();
+    for (int i = 0; i < 512; i++) atomixMixerMix(mix, bench_buff, 512);
+    double end = getTime();
+    if (perf_on) perfStop();
+    atomixMixerStopAll(mix); //mark all layers for clearing
+    atomixMixerMix(mix, bench_buff, 512); //make sure layers are actually cleared
+    printf("256: %.0ff/s <- %.0ff/s (%.3fMiB/s)\n", 262144.0/(end-start), 16777216.0/(end-start), 2.0/(end-start));
+    perfReport(262144.0, 256.0);
+    //mix 512 at a time 512 times with single sound
+    atomixMixerPlay(mix, mus, ATOMIX_LOOP, 1.0f, 0.0f);
+    if (perf_on) perfStart();
+    start = getTime();
+    for (int i = 0; i < 512; i++) atomixMixerMix(mix, bench_buff, 512);
+    end = getTime();
+    if (perf_on) perfStop();
+    atomixMixerStopAll(mix); //mark all layers for clearing
+    atomixMixerMix(mix, bench_buff, 512); //make sure layers are actually cleared
+    printf("One: %.0ff/s <- %.0ff/s (%.3fMiB/s)\n", 262144.0/(end-start), 262144.0/(end-start), 2.0/(end-start));
+    perfReport(262144.0, 1.0);
+    #ifdef ATOMIX_PROFILE
+        //cost attributed to the music across both benchmarks
+        struct atomix_profile prof;
+        atomixSoundProfile(mus, &prof, 1);
+        printf("Profile: %.0f cycles/call, %llu calls, %llu fading, %llu wrapped\n", (double)prof.cycles/prof.calls,
+            (unsigned long long)prof.calls, (unsigned long long)prof.fades, (unsigned long long)prof.wraps);
+    #endif
+    //benchmarking done
+    printf("<<BENCHMARK END>>\n");
+}
+
+//benchmarking of a single mixing kernel
+double benchKernel (struct atomix_mixer* mix, struct atomix_sound* snd, int kind, uint32_t fnum, int cold) {
+    //layer playing given sound, fade out multiplier stays close to 1
+    struct atmx_layer lay;
+    memset(&lay, 0, sizeof(lay));
+    lay.snd = snd; lay.start = 0; lay.end = snd->len; lay.fmax = 1 << 30;
+    //pitched kernel runs at a steady shift of a fifth up, or an octave and a fifth up reading mipmaps
+    float rate = (kind == 4) ? 3.0f : (kind == 3) ? 1.5f : 1.0f;
+    //unison kernel renders 8 copies detuned by up to 1%
+    struct atmx_f2 ugain = {0.5f, 0.5f}; ATMX_STORE(&lay.udet, 0.01f); ATMX_STORE(&lay.uspr, 1.0f);
+    //granular kernel keeps about 16 grains of 2048 frames playing, scattered and detuned like unison
+    ATMX_STORE(&lay.gsize, 2048); ATMX_STORE(&lay.gival, 128); ATMX_STORE(&lay.gscat, 4096);
+    ATMX_STORE(&lay.gpit, 0.01f); ATMX_STORE(&lay.gspr, 1.0f); lay.gran.seed = 1;
+    #ifndef ATOMIX_NO_SSE
+        uint32_t asize = fnum >> 1; __m128 align[asize];
+        __m128 gmul = _mm_set_ps1(0.5f);
+        memset(align, 0, sizeof(align));
+    #else
+        float align[fnum*2]; struct atmx_f2 gmul = {0.5f, 0.5f}; uint32_t asize = fnum;
+        memset(align, 0, sizeof(align));
+    #endif
+    //run 256 times after one untimed warm up, stepping through the sound if cold and evicting what will be read
+    //batches read 4 voices half a block apart, and report cycles per frame of each voice
+    uint64_t total = 0; int32_t cur = 0, span = (kind == 7) ? 3 : 1;
+    for (int i = 0; i <= 256; i++) {
+        if (cold) {
+            cur = (i*fnum) % (snd->len - (span + 1)*fnum);
+            flushData((float*)snd->data + cur*snd->cha, span*fnum*snd->cha*sizeof(float));
+        }
+        //fade out must end exactly at the end of the block, playback must be fully faded in
+        lay.fade = (kind == 1) ? (int32_t)fnum : lay.fmax;
+        ATMX_STORE(&lay.cursor, cur); lay.rate = rate;
+        uint64_t start = getCycles();
+        if (kind == 7) {
+            #ifndef ATOMIX_NO_SSE
+                for (int k = 0; k < 4; k++) {
+                    mix->batch.src[k] = &snd->data[(cur >> 2) + k*(fnum >> 3)]; mix->batch.gl[k] = mix->batch.gr[k] = 0.5f;
+                }
+                mix->batch.num = 4; atmxMixBatch(&mix->batch, align, asize);
+            #endif
+        } else if (kind == 6) {
+            atmxMixGranular(&lay, ATOMIX_LOOP, cur, rate, ugain, align, asize);
+        } else if (kind == 5) {
+            atmxMixUnison(&lay, ATOMIX_LOOP, cur, rate, 8, ugain, align, asize);
+        } else if (kind >= 3) {
+            atmxMixPitch(&lay, ATOMIX_LOOP, cur, rate, gmul, align, asize);
+        } else if (kind == 2) {
+            atmxMixBinaural(mix, &lay, ATOMIX_LOOP, cur, 0.5f, rate, 1.0f, align, asize);
+        } else if (kind == 1) {
+            if (snd->cha == 1) atmxMixFadeMono(&lay, cur, gmul, align, asize);
+            else atmxMixFadeStereo(&lay, cur, gmul, align, asize);
+        } else {
+            if (snd->cha == 1) atmxMixPlayMono(&lay, 1, cur, gmul, align, asize);
+            else atmxMixPlayStereo(&lay, 1, cur, gmul, align, asize);
+        }
+        if (i) total += getCycles() - start;
+    }
+    //return cycles per frame
+    return (double)total/(256.0*fnum*((kind == 7) ? 4 : 1));
+}
+void benchKernels () {
+    //synthetic mono and stereo sounds of 1M frames each
+    int32_t len = 1 << 20;
+    float* data = malloc(len*2*sizeof(float));
+    for (int32_t i = 0; i < len*2; i++) data[i] = (float)rand()/(float)RAND_MAX - 0.5f;
+    struct atomix_sound* snds[2] = {atomixSoundNew(1, data, len), atomixSoundNew(2, data, len)};
+    struct atomix_sound* mips[2] = {atomixSoundNewAdv(1, data, len, ATOMIX_MIPMAP), atomixSoundNewAdv(2, data, len, ATOMIX_MIPMAP)};
+    free(data);
+    //mixer providing binaural constants at 44100Hz
+    struct atomix_mixer* mix = atomixMixerNew(1.0f, 0);
+    atomixMixerBinaural(mix, 44100); atmxMixSetup(mix);
+    //every kernel at every block size, warm and cold
+    const char* names[14] = {"PlayMono", "PlayStereo", "FadeMono", "FadeStereo", "BinauralMono", "BinauralSt",
+        "PitchMono", "PitchStereo", "MipMono", "MipStereo", "Unison8Mono", "Unison8St", "Grain16Mono", "Grain16St"};
+    printf("<<KERNELS BEGIN>>\n");
+    printf("%-12s %6s %12s %12s\n", "kernel", "block", "warm cyc/f", "cold cyc/f");
+    for (int k = 0; k < 14; k++)
+        for (uint32_t fnum = 64; fnum <= 4096; fnum *= 4) {
+            struct atomix_sound* snd = ((k < 8)||(k > 9)) ? snds[k & 1] : mips[k & 1];
+            printf("%-12s %6u %12.3f %12.3f\n", names[k], fnum, benchKernel(mix, snd, k >> 1, fnum, 0),
+                benchKernel(mix, snd, k >> 1, fnum, 1));
+        }
+    #ifndef ATOMIX_NO_SSE
+        for (uint32_t fnum = 64; fnum <= 4096; fnum *= 4)
+            printf("%-12s %6u %12.3f %12.3f\n", "Batch4Mono", fnum, benchKernel(mix, snds[0], 7, fnum, 0), benchKernel(mix, snds[0], 7, fnum, 1));
+    #endif
+    printf("<<KERNELS END>>\n");
+    free(snds[0]); free(snds[1]); free(mips[0]); free(mips[1]); free(mix);
+}
+
+//random control thread activity on given mixer, remembering up to 64 recent handles
+void churn (struct atomix_mixer* mix, struct atomix_sound** snds, uint32_t* ids) {
+    //pick a random action and a random recent handle
+    struct atomix_sound* snd = snds[rand() & 1]; uint32_t* id = &ids[rand() & 63];
+    float r = (float)rand()/(float)RAND_MAX; int32_t len = atomixSoundLength(snd);
+    switch (rand() % 27) {
+        case 0: case 1: case 2: case 3: *id = atomixMixerPlay(mix, snd, 1 + rand() % 4, r, 2.0f*r - 1.0f); break;
+        case 4: case 5: *id = atomixMixerPlayAdv(mix, snd, 1 + rand() % 4, r, 0.0f, rand() % len - len/4, rand() % len + 4, rand() % 4096); break;
+        case 6: case 7: atomixMixerSetState(mix, *id, 1 + rand() % 4); break;
+        case 8: case 9: atomixMixerSetGainPan(mix, *id, r, 1.0f - 2.0f*r); break;
+        case 10: case 11: atomixMixerSetCursor(mix, *id, rand() % len); break;
+        case 12: atomixMixerFade(mix, rand() % 4096); break;
+        case 13: atomixMixerVolume(mix, r); break;
+        case 14: atomixMixerHaltAll(mix); break;
+        case 15: if (rand() & 1) atomixMixerPlayAll(mix); else atomixMixerStopAll(mix); break;
+        case 16: atomixMixerSetDirection(mix, *id, r - 0.5f, 0.5f - r, (rand() & 1) ? r : 0.0f); break;
+        case 17: atomixMixerListener(mix, 6.0f*r, r - 0.5f, 0.0f); break;
+        case 18: atomixMixerBinaural(mix, (rand() & 1) ? 44100 : 0); break;
+        case 19: atomixMixerSetVelocity(mix, *id, 400.0f*r - 200.0f, 0.0f, 0.0f); break;
+        case 20: atomixMixerSetPitch(mix, *id, 0.25f + 4.0f*r); break;
+        case 21: atomixMixerSetUnison(mix, *id, 1 + rand() % 8, 0.02f*r, r); break;
+        case 22: atomixMixerSetGranular(mix, *id, (rand() % 2)*(rand() % 4096), 1 + rand() % 512, rand() % 8192, 0.1f*r, r); break;
+        case 23: atomixMixerSetLoops(mix, *id, rand() % 4 - 1); break;
+        case 24: atomixMixerRelease(mix, *id); break;
+        case 25: atomixMixerSetPriority(mix, *id, rand() & 255); break;
+        case 26: atomixMixerBudget(mix, (rand() & 1) ? 0 : rand() % 200000); break;
+    }
+}
+
+//real-time safety check of the mixing thread
+#if defined(TEST_RTCHECK)&&defined(__GLIBC__)
+struct rt_args {
+    struct atomix_mixer* mix; //mixer to mix from
+    _Atomic(int) done; //set by mixing thread when finished
+};
+THREAD_FUNC(rtMixer) {
+    //mix random frame counts with a local generator, as rand may lock
+    struct rt_args* args = arg; uint32_t x = 2463534242u;
+    float* buff = malloc(4096*2*sizeof(float));
+    for (int i = 0; i < 50000; i++) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        rt_mixing = 1;
+        atomixMixerMix(args->mix, buff, 1 + x % 4096);
+        rt_mixing = 0;
+    }
+    free(buff);
+    atomic_store(&args->done, 1);
+    return 0;
+}
+int rtCheck (struct atomix_sound** snds) {
+    //print configuration being checked
+    printf("<<RTCHECK BEGIN>>\n");
+    #ifdef ATOMIX_NO_SSE
+        printf("Configuration: NO_SSE");
+    #else
+        printf("Configuration: SSE");
+    #endif
+    #ifdef ATOMIX_NO_CLIP
+        printf(" NO_CLIP");
+    #endif
+    #ifdef ATOMIX_PROFILE
+        printf(" PROFILE");
+    #endif
+    printf(" LBITS=%d\n", ATOMIX_LBITS);
+    //atomics that are not lock-free hide locks inside the atomics library
+    struct atmx_layer lay; struct atomix_mixer* mix = atomixMixerNew(0.5f, 256);
+    if (!atomic_is_lock_free(&lay.flag)||!atomic_is_lock_free(&lay.cursor)||!atomic_is_lock_free(&lay.gain)||!atomic_is_lock_free(&mix->volume))
+        printf("Warning: atomics are not lock-free!\n");
+    //mix on another thread while churning through control calls on this one
+    struct rt_args args = {mix, 0}; thread_t thr; uint32_t ids[64] = {0}; long calls = 0;
+    threadStart(&thr, rtMixer, &args);
+    while (!atomic_load(&args.done)) { churn(mix, snds, ids); calls++; }
+    threadJoin(thr);
+    //report result
+    int fails = atomic_load(&rt_fails);
+    if (fails) printf("FAILED: %d forbidden calls while mixing, last was %s\n", fails, atomic_load(&rt_last));
+    else printf("Passed: 50000 mixes against %ld control calls\n", calls);
+    printf("<<RTCHECK END>>\n");
+    free(mix);
+    return (fails != 0);
+}
+#endif
+
+//real-time mode with sounds and mixers locked into memory
+#if defined(ATOMIX_MLOCK)&&!defined(WIN32)
+#include <sys/resource.h>
+long lockedKB () {
+    //locked memory of this process from /proc in KB, -1 if unavailable
+    FILE* f = fopen("/proc/self/status", "r"); char line[256]; long kb = -1;
+    if (!f) return -1;
+    while (fgets(line, sizeof(line), f)) if (!strncmp(line, "VmLck:", 6)) kb = strtol(line + 6, NULL, 10);
+    fclose(f);
+    return kb;
+}
+int mlockTest (struct atomix_sound** snds) {
+    //a new mixer and a fresh copy of the music are locked as they are created
+    printf("<<MLOCK BEGIN>>\n");
+    long before = lockedKB(); int32_t len = atomixSoundLength(snds[0]); uint8_t cha = atomixSoundChannels(snds[0]);
+    struct atomix_mixer* mix = atomixMixerNew(0.5f, 0);
+    struct atomix_sound* cold = atomixSoundAlloc(cha, len, 0);
+    memcpy(atomixSoundData(cold), snds[0]->data, (size_t)len*cha*sizeof(float)); atomixSoundFinish(cold, len);
+    long after = lockedKB(), want = (long)((size_t)len*cha*sizeof(float) + sizeof(struct atomix_mixer))/1024 - 8;
+    //switch to real-time priority, which needs privileges, faulting in the stack along the way
+    float buff[2048]; memset(buff, 0, sizeof(buff));
+    int rt = atomixThreadRealtime(10);
+    //mix the originals once so the code is paged in, then the first mixes of the copy should not fault a single page
+    atomixMixerPlay(mix, snds[0], ATOMIX_PLAY, 0.5f, 0.0f); atomixMixerPlay(mix, snds[1], ATOMIX_LOOP, 0.5f, 0.0f);
+    for (int i = 0; i < 4; i++) atomixMixerMix(mix, buff, 1024);
+    atomixMixerPlay(mix, cold, ATOMIX_LOOP, 0.5f, 0.0f);
+    struct rusage ru0, ru1; getrusage(RUSAGE_SELF, &ru0);
+    for (int i = 0; i < 256; i++) atomixMixerMix(mix, buff, 1024);
+    getrusage(RUSAGE_SELF, &ru1);
+    long faults = (ru1.ru_minflt - ru0.ru_minflt) + (ru1.ru_majflt - ru0.ru_majflt);
+    if (rt) { struct sched_param sp = {0}; pthread_setschedparam(pthread_self(), SCHED_OTHER, &sp); }
+    //freeing unlocks again
+    atomixMixerStopAll(mix); atomixMixerMix(mix, buff, 1024);
+    atomixSoundFree(cold); atomixMixerFree(mix);
+    long freed = lockedKB();
+    printf("Locked %ld KB before, %ld KB after creating, %ld KB after freeing\n", before, after, freed);
+    if (after - before < want) printf("Warning: lock limit reached, pages were only faulted in\n");
+    printf("Real-time priority %s, %ld page faults in 256 mixes\n", rt ? "set" : "not permitted", faults);
+    int ok = (faults == 0)&&((after - before < want)||(freed < after));
+    printf("Mlock %s\n", ok ? "OK" : "FAILED");
+    printf("<<MLOCK END>>\n");
+    return !ok;
+}
+#endif
+
+//contention stress test of the wait-free protocol
+#define STRESS_MAX 1048576
+struct stress_args {
+    struct atomix_mixer* mix; //mixer to mix from
+    _Atomic(int) run; //cleared to stop the mixing thread
+    _Atomic(uint64_t) frames; //frames mixed so far
+    uint64_t* lats; long lnum; //latency of every mix call in cycles
+};
+struct stress_stop {
+    uint32_t id; //handle that was stopped
+    uint64_t frames; //frames mixed when it was stopped
+};
+THREAD_FUNC(stressMixer) {
+    //mix 512 frames at a time in a tight loop, timing every call
+    struct stress_args* args = arg; float buff[1024];
+    while (atomic_load(&args->run)) {
+        uint64_t start = getCycles();
+        atomixMixerMix(args->mix, buff, 512);
+        uint64_t lat = getCycles() - start;
+        if (args->lnum < STRESS_MAX) args->lats[args->lnum++] = lat;
+        atomic_fetch_add(&args->frames, 512);
+    }
+    return 0;
+}
+void stressWait (struct stress_args* args, uint64_t frames) {
+    //wait until the mixing thread has mixed at least given number of frames more
+    uint64_t target = atomic_load(&args->frames) + frames;
+    while (atomic_load(&args->frames) < target) psleep(0.0001);
+}
+static int stressCompare (const void* a, const void* b) {
+    //compare uint64_t for qsort
+    return (*(uint64_t*)a > *(uint64_t*)b) - (*(uint64_t*)a < *(uint64_t*)b);
+}
+void stressReport (const char* name, struct stress_args* args, double cps) {
+    //sort latencies and print distribution in microseconds
+    long n = args->lnum; uint64_t* l = args->lats;
+    qsort(l, n, sizeof(uint64_t), stressCompare);
+    printf("%s: %ld mixes, p50 %.2fus p99 %.2fus p99.9 %.2fus max %.2fus\n", name, n, l[n/2]/cps*1e6,
+        l[n*99/100]/cps*1e6, l[n*999/1000]/cps*1e6, l[n - 1]/cps*1e6);
+}
+int stressTest (struct atomix_sound** snds) {
+    //fade of up to 4096 frames, so anything stopped must be cleared within 4096 frames plus two blocks
+    struct atomix_mixer* mix = atomixMixerNew(0.5f, 1024);
+    struct stress_args args = {mix, 1, 0, malloc(STRESS_MAX*sizeof(uint64_t)), 0};
+    struct stress_stop stops[1024]; int snum = 0; long calls = 0, checked = 0, lost = 0, stuck = 0;
+    uint32_t ids[64] = {0}; thread_t thr;
+    uint64_t c0 = getCycles(); double t0 = getTime();
+    printf("<<STRESS BEGIN>>\n");
+    //uncontended baseline with 64 looping voices
+    for (int i = 0; i < 64; i++) atomixMixerPlay(mix, snds[i & 1], ATOMIX_LOOP, 0.1f, 0.0f);
+    threadStart(&thr, stressMixer, &args);
+    psleep(0.5);
+    atomic_store(&args.run, 0); threadJoin(thr);
+    double cps = (getCycles() - c0)/(getTime() - t0);
+    stressReport("Uncontended", &args, cps);
+    //contended run of 20 phases, each ending with a full stop that must drain every layer
+    args.lnum = 0; atomic_store(&args.run, 1);
+    threadStart(&thr, stressMixer, &args);
+    for (int p = 0; p < 20; p++) {
+        //same 64 looping voices as the baseline to churn alongside
+        for (int i = 0; i < 64; i++) atomixMixerPlay(mix, snds[i & 1], ATOMIX_LOOP, 0.1f, 0.0f);
+        double start = getTime();
+        while (getTime() - start < 0.1) {
+            churn(mix, snds, ids); calls++;
+            //explicitly stop a random handle every so often, never touching it again
+            uint32_t* id = &ids[rand() & 63];
+            if ((!(calls & 7))&&(*id)&&(snum < 1024)&&(atomixMixerSetState(mix, *id, ATOMIX_STOP))) {
+                stops[snum].id = *id; stops[snum++].frames = atomic_load(&args.frames); *id = 0;
+            }
+            //stops old enough must have cleared their layer unless it was already reused
+            uint64_t frames = atomic_load(&args.frames);
+            for (int i = 0; i < snum; i++) if (frames - stops[i].frames > 5120) {
+                struct atmx_layer* lay = &mix->lays[stops[i].id & ATMX_LMASK];
+                if ((lay->id == stops[i].id)&&(ATMX_LOAD(&lay->flag))) lost++;
+                stops[i--] = stops[--snum]; checked++;
+            }
+        }
+        //every layer must be free after stopping all and waiting out the longest fade
+        atomixMixerStopAll(mix); stressWait(&args, 5120);
+        for (int i = 0; i < ATMX_LAYERS; i++) if (ATMX_LOAD(&mix->lays[i].flag)) stuck++;
+        for (int i = 0; i < 64; i++) ids[i] = 0;
+        snum = 0;
+    }
+    atomic_store(&args.run, 0); threadJoin(thr);
+    stressReport("Contended", &args, cps);
+    //the mixing order must list every listed layer exactly once, and no layer once everything stopped
+    int seen[ATMX_LAYERS] = {0}; long order = mix->act;
+    for (int i = 0; i < mix->act; i++) seen[mix->order[i]]++;
+    for (int i = 0; i < ATMX_LAYERS; i++) order += (seen[i] != mix->lays[i].listed);
+    //report invariants
+    printf("%ld control calls, %ld stops checked, %ld lost stops, %ld stuck layers, %ld misordered layers\n", calls, checked, lost, stuck, order);
+    printf("<<STRESS END>>\n");
+    free(args.lats); free(mix);
+    return (lost || stuck || order);
+}
+
+//degrading gracefully under a time budget
+int budgetScene (const char* name, struct atomix_sound* a, struct atomix_sound* b, int pitched, int part) {
+    //200 looping voices, the first 20 of which matter most
+    struct atomix_mixer* mix = atomixMixerNew(0.5f, 0); uint32_t ids[200]; float buff[2048];
+    for (int i = 0; i < 200; i++) {
+        ids[i] = atomixMixerPlay(mix, (i & 1) ? b : a, ATOMIX_LOOP, 0.01f, 0.0f);
+        if (pitched) atomixMixerSetPitch(mix, ids[i], 0.5f + (i % 7)*0.25f);
+        if (i < 20) atomixMixerSetPriority(mix, ids[i], 255);
+    }
+    //cost of a full mix in clock ticks, then a budget of given eighths of that
+    uint64_t full = (uint64_t)-1, worst = 0;
+    for (int i = 0; i < 64; i++) {
+        uint64_t c = ATOMIX_CLOCK(); atomixMixerMix(mix, buff, 1024); c = ATOMIX_CLOCK() - c;
+        if (c < full) full = c;
+    }
+    atomixMixerBudget(mix, (uint32_t)(full*part/8));
+    for (int i = 0; i < 256; i++) {
+        uint64_t c = ATOMIX_CLOCK(); atomixMixerMix(mix, buff, 1024); c = ATOMIX_CLOCK() - c;
+        if (c > worst) worst = c;
+    }
+    //some mixes degraded, never down to the priority voices, rarely over budget, and every voice is still playing
+    struct atomix_stats st; atomixMixerStats(mix, &st, 1);
+    int ok = (st.mixes == 256)&&(st.degraded > 0)&&(st.virtualized <= 180*st.degraded)&&(st.overruns <= st.mixes/4);
+    for (int i = 0; i < 200; i++) ok &= (mix->lays[ids[i] & ATMX_LMASK].id == ids[i])&&ATMX_LOAD(&mix->lays[ids[i] & ATMX_LMASK].flag);
+    printf("%s: full mix %llu ticks, budget %llu ticks, worst %llu ticks\n", name, (unsigned long long)full,
+        (unsigned long long)(full*part/8), (unsigned long long)worst);
+    printf("%s: %llu mixes, %llu degraded, %.1f voices virtualized per degraded mix, %llu overruns\n", name, (unsigned long long)st.mixes,
+        (unsigned long long)st.degraded, st.degraded ? (double)st.virtualized/st.degraded : 0.0, (unsigned long long)st.overruns);
+    printf("%s: budget %s\n", name, ok ? "OK" : "FAILED");
+    free(mix);
+    return !ok;
+}
+int budgetTest (struct atomix_sound** snds) {
+    //pitched stereo voices, then plain mono voices that are queued and mixed 4 at a time
+    //the latter cost little more to mix than to virtualize, so they need more of their full mix
+    float* left = malloc(snds[0]->len*sizeof(float));
+    for (int32_t i = 0; i < snds[0]->len; i++) left[i] = ((float*)snds[0]->data)[i*snds[0]->cha];
+    struct atomix_sound* mono = atomixSoundNew(1, left, snds[0]->len);
+    printf("<<BUDGET BEGIN>>\n");
+    int fail = budgetScene("Pitched", snds[0], snds[1], 1, 4);
+    fail |= budgetScene("Mono", mono, mono, 0, 6);
+    printf("<<BUDGET END>>\n");
+    free(left); free(mono);
+    return fail;
+}
+
+//estimating mix cost from a calibrated model
+int estimateTest (struct atomix_sound** snds) {
+    //calibrate once, printing ticks per layer, unison voices mixed at once, or grain and frame of each path
+    static const char* names[9] = {"mono", "stereo", "pitch", "binaural", "unison", "voices", "granular", "grain", "mix"};
+    #ifndef ATOMIX_NO_SSE
+        static const char* units[9] = {"layer", "layer", "layer", "layer", "layer", "4 voices", "layer", "grain", "mix"};
+    #else
+        static const char* units[9] = {"layer", "layer", "layer", "layer", "layer", "voice", "layer", "grain", "mix"};
+    #endif
+    struct atomix_mixer* mix = atomixMixerNew(0.5f, 0); float buff[2048]; int ok = 1;
+    printf("<<ESTIMATE BEGIN>>\n");
+    double t = getTime(); uint64_t c = ATOMIX_CLOCK(); ok &= atomixMixerCalibrate(mix); c = ATOMIX_CLOCK() - c;
+    printf("Calibrated in %llu ticks (%.1fms)\n", (unsigned long long)c, (getTime() - t)*1000.0);
+    for (int i = 0; i < 9; i++) printf("%-9s %7.2f ticks per %s and frame\n", names[i], mix->cost[i], units[i]);
+    //left channel of the music as a mono sound
+    float* left = malloc(snds[0]->len*sizeof(float));
+    for (int32_t i = 0; i < snds[0]->len; i++) left[i] = ((float*)snds[0]->data)[i*snds[0]->cha];
+    struct atomix_sound* mono = atomixSoundNew(1, left, snds[0]->len); free(left);
+    //scenes of 24 voices each taking one path, with unison voices and grains other than calibrated, then all at once
+    static const char* scenes[11] = {"mono", "stereo", "pitch", "binaural", "unison 2", "unison 5", "unison 8",
+        "grains 4", "grains 8", "grains 16", "all"};
+    for (int s = 0; s < 11; s++) {
+        atomixMixerBinaural(mix, (s == 3)||(s == 10) ? 48000 : 0);
+        for (int i = 0; i < 24; i++) {
+            int p = (s < 10) ? s : i % 10;
+            uint32_t id = atomixMixerPlay(mix, (p == 0) ? mono : snds[0], ATOMIX_LOOP, 0.01f, 0.0f);
+            if (p == 2) atomixMixerSetPitch(mix, id, 0.5f + (i % 7)*0.25f);
+            if (p == 3) atomixMixerSetDirection(mix, id, cosf((float)i), sinf((float)i), 0.0f);
+            if ((p >= 4)&&(p <= 6)) atomixMixerSetUnison(mix, id, (p == 4) ? 2 : (p == 5) ? 5 : 8, 0.1f, 1.0f);
+            if (p >= 7) atomixMixerSetGranular(mix, id, (p == 9) ? 2048 : 1024, (p == 7) ? 256 : 128, 1024, 0.1f, 1.0f);
+        }
+        //fastest of a few mixes once grains have spawned against the estimate, which another voice should add to
+        //scenes off by more than a fifth are retried after calibrating again, in case the core changed its clock
+        uint64_t est = 0, best = (uint64_t)-1; double err = 1.0; int tries = 0;
+        for (; (tries < 3)&&((err < -0.2)||(err > 0.2)); tries++) {
+            if (tries) atomixMixerCalibrate(mix);
+            est = atomixMixerEstimate(mix, 1024, NULL); best = (uint64_t)-1;
+            for (int i = 0; i < 36; i++) {
+                c = ATOMIX_CLOCK(); atomixMixerMix(mix, buff, 1024); c = ATOMIX_CLOCK() - c;
+                if ((i >= 4)&&(c < best)) best = c;
+            }
+            err = (double)est/(double)best - 1.0;
+        }
+        ok &= (err >= -0.2)&&(err <= 0.2)&&(atomixMixerEstimate(mix, 1024, snds[0]) > est);
+        printf("%-9s estimated %8llu ticks, measured %8llu ticks, error %+5.1f%% (%d %s)\n", scenes[s],
+            (unsigned long long)est, (unsigned long long)best, err*100.0, tries, (tries > 1) ? "tries" : "try");
+        atomixMixerHaltAll(mix); atomixMixerMix(mix, buff, 1024);
+        for (int i = 0; i < ATMX_LAYERS; i++) ATMX_STORE(&mix->lays[i].flag, (uint8_t)0);
+    }
+    printf("Estimate %s\n", ok ? "OK" : "FAILED");
+    printf("<<ESTIMATE END>>\n");
+    atomixSoundFree(mono); free(mix);
+    return !ok;
+}
+
+//looping again after leaving a sustain loop
+int loopTest (struct atomix_sound** snds) {
+    //sustain loop over the first 4096 frames of the music, released and played into its tail
+    struct atomix_mixer* mix = atomixMixerNew(0.5f, 0); float buff[512]; int ok = 1;
+    struct atmx_layer* lay; uint32_t id = atomixMixerPlayAdv(mix, snds[0], ATOMIX_LOOP, 0.5f, 0.0f, 0, 4096, 0);
+    printf("<<LOOPS BEGIN>>\n");
+    lay = &mix->lays[id & ATMX_LMASK];
+    for (int i = 0; i < 20; i++) atomixMixerMix(mix, buff, 256);
+    atomixMixerRelease(mix, id);
+    for (int i = 0; i < 20; i++) atomixMixerMix(mix, buff, 256);
+    int32_t cur = ATMX_LOAD(&lay->cursor);
+    ok &= (ATMX_LOAD(&lay->flag) == ATOMIX_PLAY)&&(cur > 4096);
+    printf("Released: cursor %d, %s\n", cur, (ATMX_LOAD(&lay->flag) == ATOMIX_PLAY) ? "playing" : "LOOPING");
+    //looping again wraps back into the loop and stays there
+    atomixMixerSetState(mix, id, ATOMIX_LOOP);
+    int inside = 1;
+    for (int i = 0; i < 100; i++) { atomixMixerMix(mix, buff, 256); inside &= (ATMX_LOAD(&lay->cursor) <= 4096); }
+    ok &= inside&&(ATMX_LOAD(&lay->flag) == ATOMIX_LOOP);
+    printf("Looping again: %s\n", inside ? "inside the loop" : "OUTSIDE THE LOOP");
+    //a count given afterwards runs out and leaves the loop once more
+    atomixMixerSetLoops(mix, id, 2);
+    for (int i = 0; i < 100; i++) atomixMixerMix(mix, buff, 256);
+    cur = ATMX_LOAD(&lay->cursor);
+    ok &= (ATMX_LOAD(&lay->flag) == ATOMIX_PLAY)&&(cur > 4096);
+    printf("Counted out: cursor %d, %s\n", cur, (ATMX_LOAD(&lay->flag) == ATOMIX_PLAY) ? "playing" : "LOOPING");
+    printf("Loops %s\n", ok ? "OK" : "FAILED");
+    printf("<<LOOPS END>>\n");
+    free(mix);
+    return !ok;
+}
+
+//ramping the playback rate back to the original
+int pitchTest (struct atomix_sound** snds) {
+    //plain, unison, granular, and binaural voices at both block sizes, each pitched down and back up again
+    static const char* names[4] = {"plain", "unison", "granular", "binaural"};
+    struct atomix_mixer* mix = atomixMixerNew(0.5f, 0); float buff[1024]; int ok = 1;
+    printf("<<PITCH BEGIN>>\n");
+    for (uint32_t fnum = 256; fnum <= 512; fnum *= 2) {
+        atomixMixerBinaural(mix, 48000); uint32_t ids[4];
+        for (int p = 0; p < 4; p++) {
+            ids[p] = atomixMixerPlay(mix, snds[0], ATOMIX_LOOP, 0.01f, 0.0f);
+            if (p == 1) atomixMixerSetUnison(mix, ids[p], 4, 0.1f, 1.0f);
+            if (p == 2) atomixMixerSetGranular(mix, ids[p], 2048, 256, 1024, 0.1f, 1.0f);
+            if (p == 3) atomixMixerSetDirection(mix, ids[p], 1.0f, 0.0f, 0.0f);
+            atomixMixerSetPitch(mix, ids[p], 0.26f);
+        }
+        for (int i = 0; i < 5; i++) atomixMixerMix(mix, buff, fnum);
+        for (int p = 0; p < 4; p++) atomixMixerSetPitch(mix, ids[p], 1.0f);
+        for (int i = 0; i < 200; i++) atomixMixerMix(mix, buff, fnum);
+        //every voice has landed exactly on its original rate, so the plain one is no longer interpolating
+        for (int p = 0; p < 4; p++) {
+            struct atmx_layer* lay = &mix->lays[ids[p] & ATMX_LMASK];
+            ok &= (lay->rate == 1.0f);
+            printf("%-8s %3u frames per mix, rate %.9f\n", names[p], fnum, lay->rate);
+        }
+        ok &= !atmxPitched(&mix->lays[ids[0] & ATMX_LMASK], 1.0f);
+        atomixMixerHaltAll(mix); atomixMixerMix(mix, buff, fnum);
+        for (int i = 0; i < ATMX_LAYERS; i++) ATMX_STORE(&mix->lays[i].flag, (uint8_t)0);
+    }
+    printf("Pitch %s\n", ok ? "OK" : "FAILED");
+    printf("<<PITCH END>>\n");
+    free(mix);
+    return !ok;
+}
+
+//sharing sounds with identical content through a registry
+int dedupTest (struct atomix_sound** snds) {
+    //content of both sounds as plain floats, plus a copy of the music differing in a single sample
+    float* data[3]; int32_t lens[3] = {snds[0]->len, snds[1]->len, snds[0]->len}; uint8_t chas[3] = {snds[0]->cha, snds[1]->cha, snds[0]->cha};
+    for (int i = 0; i < 3; i++) {
+        data[i] = malloc(lens[i]*chas[i]*sizeof(float));
+        memcpy(data[i], snds[i & 1]->data, lens[i]*chas[i]*sizeof(float));
+    }
+    data[2][lens[2]] += 0.001f;
+    //register music 4 times, sound 3 times, and the differing copy once
+    struct atomix_registry* reg = atomixRegistryNew(); struct atomix_sound* got[8];
+    int order[8] = {0, 1, 0, 2, 1, 0, 0, 1}, fail = 0;
+    printf("<<DEDUP BEGIN>>\n");
+    double t0 = getTime();
+    for (int i = 0; i < 8; i++) got[i] = atomixRegistrySound(reg, chas[order[i]], data[order[i]], lens[order[i]], 0);
+    double secs = getTime() - t0;
+    for (int i = 0; i < 8; i++) fail |= (!got[i])||(got[i] != got[(order[i] == 2) ? i : (order[i] == 0) ? 0 : 1]);
+    fail |= (got[3] == got[0]);
+    //report sharing and throughput including verification
+    struct atomix_dedup st; atomixRegistryStats(reg, &st);
+    double total = 0.0;
+    for (int i = 0; i < 8; i++) total += (double)lens[order[i]]*chas[order[i]]*sizeof(float);
+    printf("%llu sounds, %llu references, %.1f MB stored, %.1f MB saved, %.2f GB/s\n", (unsigned long long)st.sounds,
+        (unsigned long long)st.refs, (double)st.bytes/1048576.0, (double)st.saved/1048576.0, total/secs/1e9);
+    //only the last reference to each sound is reported as such, releasing it again or an unregistered sound fails
+    int last = 0, held = 0; struct atomix_sound* own = atomixSoundNew(chas[1], data[1], lens[1]);
+    held |= (atomixRegistryRelease(reg, own) != -1); free(own);
+    for (int i = 0; i < 8; i++) if (atomixRegistryRelease(reg, got[i]) == 1) {
+        last++; held |= (atomixRegistryRelease(reg, got[i]) != -1); free(got[i]);
+    }
+    atomixRegistryStats(reg, &st);
+    fail |= (last != 3)||held||st.sounds||st.refs||st.bytes||st.saved;
+    printf("Registry %s\n", fail ? "FAILED" : "OK");
+    //music with its left channel duplicated collapses to mono and is shared as such, the music itself does not
+    float* dual = malloc(lens[0]*2*sizeof(float)); int mono = 0;
+    for (int32_t i = 0; i < lens[0]; i++) dual[i*2] = dual[i*2+1] = data[0][i*chas[0]];
+    t0 = getTime();
+    for (int i = 0; i < 2; i++) got[i] = atomixRegistrySound(reg, 2, dual, lens[0], ATOMIX_MONO);
+    secs = getTime() - t0;
+    got[2] = atomixRegistrySound(reg, chas[0], data[0], lens[0], ATOMIX_MONO);
+    mono = got[0] && got[2] && (got[0] == got[1])&&(atomixSoundChannels(got[0]) == 1)&&(atomixSoundChannels(got[2]) == chas[0]);
+    printf("Dual mono %s, %.2f GB/s\n", mono ? "OK" : "FAILED", 2.0*lens[0]*2*sizeof(float)/secs/1e9);
+    for (int i = 0; i < 3; i++) if (atomixRegistryRelease(reg, got[i]) == 1) free(got[i]);
+    fail |= !mono; free(dual);
+    printf("<<DEDUP END>>\n");
+    for (int i = 0; i < 3; i++) free(data[i]);
+    free(reg);
+    return fail;
+}
+
+//decoding a file straight into a new sound
+struct atomix_sound* loadSound (const char* path) {
+    //vorbis files at 48kHz decode with stb_vorbis, which knows their length up front
+    struct atomix_sound* snd = NULL;
+    int err; stb_vorbis* vorb = stb_vorbis_open_filename(path, &err, NULL);
+    if (vorb) {
+        stb_vorbis_info info = stb_vorbis_get_info(vorb);
+        int32_t len = (int32_t)stb_vorbis_stream_length_in_samples(vorb), got = 0, n = 1;
+        if ((info.sample_rate == 48000)&&(info.channels <= 2)&&(len > 0)) snd = atomixSoundAlloc(info.channels, len, 0);
+        if (snd) {
+            while ((got < len)&&(n > 0)) got += (n = stb_vorbis_get_samples_float_interleaved(vorb, info.channels,
+                atomixSoundData(snd) + got*info.channels, (len - got)*info.channels));
+            if (atomixSoundFinish(snd, got)) { free(snd); snd = NULL; }
+        } else if ((info.channels <= 2)&&(len > 0)) {
+            //other rates decode into a temporary buffer and resample from there
+            float* data = malloc((size_t)len*info.channels*sizeof(float));
+            if (data) while ((got < len)&&(n > 0)) got += (n = stb_vorbis_get_samples_float_interleaved(vorb, info.channels,
+                data + got*info.channels, (len - got)*info.channels));
+            if (got > 0) snd = atomixSoundNewRate(info.channels, data, got, 0, info.sample_rate, 48000);
+            free(data);
+        }
+        stb_vorbis_close(vorb);
+        if (snd) return snd;
+    }
+    //otherwise open a miniaudio decoder converting to floats at 48kHz, keeping channels
+    ma_decoder dec; ma_decoder_config cfg = ma_decoder_config_init(ma_format_f32, 0, 48000);
+    if (ma_decoder_init_file(path, &cfg, &dec) != MA_SUCCESS) return NULL;
+    //length is reported at the rate of the file, so leave some room for resampling
+    ma_uint64 len = ma_decoder_get_length_in_pcm_frames(&dec);
+    if (dec.internalSampleRate != 48000) len = len*48000/dec.internalSampleRate + 64;
+    if ((len > 0)&&(len < INT32_MAX)&&(dec.outputChannels <= 2)) snd = atomixSoundAlloc(dec.outputChannels, len, 0);
+    if (snd) {
+        ma_uint64 got = ma_decoder_read_pcm_frames(&dec, atomixSoundData(snd), len);
+        if (atomixSoundFinish(snd, (int32_t)got)) { free(snd); snd = NULL; }
+        ma_decoder_uninit(&dec);
+        return snd;
+    }
+    //if the length is unknown, decode into a temporary buffer and copy that instead
+    void* data; ma_uint64 frames;
+    if (ma_decoder__full_decode_and_uninit(&dec, &cfg, &frames, &data) != MA_SUCCESS) return NULL;
+    if ((frames > 0)&&(frames < INT32_MAX)) snd = atomixSoundNew(cfg.channels, data, frames);
+    ma_free(data);
+    return snd;
+}
+
+//resampling sounds to the mixer rate at load time
+int resampleTest () {
+    //one second of a stereo tone at each rate, resampled to 48kHz and compared against the same tone made there
+    uint32_t rates[4] = {22050, 44100, 32000, 96000}; float freqs[2] = {1000.0f, 15000.0f}; int fail = 0;
+    printf("<<RESAMPLE BEGIN>>\n");
+    for (int r = 0; r < 4; r++) for (int f = 0; f < 2; f++) {
+        //only tones well below both nyquist frequencies, the others are expected to be filtered out
+        uint32_t from = rates[r];
+        if (freqs[f] > 0.45f*from) continue;
+        float* data = malloc(from*2*sizeof(float));
+        for (uint32_t i = 0; i < from; i++) {
+            data[i*2] = (float)(0.5*sin(6.283185307*freqs[f]*i/from));
+            data[i*2+1] = (float)(0.5*cos(6.283185307*freqs[f]*i/from));
+        }
+        double t0 = getTime();
+        struct atomix_sound* snd = atomixSoundNewRate(2, data, from, 0, from, 48000);
+        double secs = getTime() - t0, err = 0.0, sig = 0.0;
+        //skip the edges, where the filter runs into silence
+        for (int32_t i = 480; i < 47520; i++) for (int k = 0; k < 2; k++) {
+            double ref = 0.5*(k ? cos(6.283185307*freqs[f]*i/48000.0) : sin(6.283185307*freqs[f]*i/48000.0));
+            double d = ((float*)snd->data)[i*2 + k] - ref; err += d*d; sig += ref*ref;
+        }
+        double snr = 10.0*log10(sig/err); int ok = (snd->len == 48000)&&(snr > 70.0);
+        printf("%5u to 48000Hz, %5.0fHz tone %s, %.1f dB signal to error, %.2f ms\n", from, freqs[f], ok ? "OK" : "FAILED", snr, secs*1000.0);
+        fail |= !ok; free(snd); free(data);
+    }
+    //going down, a tone above the new nyquist frequency must be filtered out instead of folding back
+    float* data = malloc(48000*sizeof(float)); double out = 0.0;
+    for (int32_t i = 0; i < 48000; i++) data[i] = (float)(0.5*sin(6.283185307*15000.0*i/48000.0));
+    struct atomix_sound* snd = atomixSoundNewRate(1, data, 48000, 0, 48000, 22050);
+    for (int32_t i = 220; i < 21830; i++) out += ((float*)snd->data)[i]*((float*)snd->data)[i];
+    double att = 10.0*log10(out/21610.0/0.125); int ok = (snd->len == 22052)&&(att < -60.0);
+    printf("48000 to 22050Hz, 15000Hz tone %s, %.1f dB after filtering\n", ok ? "OK" : "FAILED", att);
+    fail |= !ok; free(snd); free(data);
+    printf("<<RESAMPLE END>>\n");
+    return fail;
+}
+
+//creating sounds from integer samples
+int formatTest (struct atomix_sound* mus) {
+    //music quantized to each integer format, little-endian, 24-bit packed in 3 bytes
+    int32_t num = mus->len*mus->cha; float* fdat = (float*)mus->data; int fail = 0;
+    uint8_t* pcm = malloc((size_t)num*3); float* tmp = malloc(num*sizeof(float));
+    const char* names[3] = {"U8", "S16", "S24"}; int bytes[3] = {1, 2, 3}; double scales[3] = {128.0, 32768.0, 8388608.0};
+    printf("<<FORMATS BEGIN>>\n");
+    for (uint8_t fmt = ATOMIX_U8; fmt <= ATOMIX_S24; fmt++) {
+        double scl = scales[fmt - 1];
+        for (int32_t i = 0; i < num; i++) {
+            double v = floor(fdat[i]*scl + 0.5); if (v > scl - 1.0) v = scl - 1.0; if (v < -scl) v = -scl;
+            int32_t x = (int32_t)v + ((fmt == ATOMIX_U8) ? 128 : 0);
+            for (int b = 0; b < bytes[fmt - 1]; b++) pcm[(size_t)i*bytes[fmt - 1] + b] = (uint8_t)(x >> (b*8));
+        }
+        //direct conversion against converting into a temporary float buffer first
+        double t0 = getTime(), t1, t2; float err = 0.0f;
+        struct atomix_sound* snd = atomixSoundNewPCM(mus->cha, pcm, mus->len, fmt, 0);
+        t1 = getTime();
+        for (int32_t i = 0; i < num; i++) {
+            int32_t x = 0;
+            for (int b = 0; b < bytes[fmt - 1]; b++) x |= (int32_t)pcm[(size_t)i*bytes[fmt - 1] + b] << (b*8);
+            if (fmt == ATOMIX_U8) x -= 128; else if ((fmt == ATOMIX_S16)&&(x & 0x8000)) x -= 0x10000; else if ((fmt == ATOMIX_S24)&&(x & 0x800000)) x -= 0x1000000;
+            tmp[i] = (float)(x/scl);
+        }
+        struct atomix_sound* ref = atomixSoundNew(mus->cha, tmp, mus->len);
+        t2 = getTime();
+        //both must be identical and within half a step of the music
+        for (int32_t i = 0; i < num; i++) err = fmaxf(err, fabsf(((float*)snd->data)[i] - fdat[i]));
+        int ok = snd && ref && !memcmp(snd->data, ref->data, num*sizeof(float))&&(err <= 0.5f/scl + 1e-6f);
+        printf("%-4s %s, max error %.2f steps, %.2f ms direct, %.2f ms through floats\n", names[fmt - 1], ok ? "OK" : "FAILED",
+            err*scl, (t1 - t0)*1000.0, (t2 - t1)*1000.0);
+        fail |= !ok; free(snd); free(ref);
+    }
+    //a sound filled in place with nothing written must fail to finish and refuse to play
+    struct atomix_mixer* mix = atomixMixerNew(1.0f, 0); struct atomix_sound* empty = atomixSoundAlloc(mus->cha, 4096, 0);
+    int ok = empty && atomixSoundFinish(empty, 0) && !atomixSoundLength(empty) && !atomixMixerPlay(mix, empty, ATOMIX_PLAY, 1.0f, 0.0f);
+    printf("EMPTY %s\n", ok ? "OK" : "FAILED");
+    fail |= !ok; free(empty); free(mix);
+    printf("<<FORMATS END>>\n");
+    free(pcm); free(tmp);
+    return fail;
+}
+
+//sharing sounds with a second process through a shared memory bank
+#if defined(ATOMIX_SHM)&&!defined(WIN32)
+#include <sys/wait.h>
+double bankChecksum (struct atomix_sound* mus, struct atomix_sound* snd) {
+    //same scene in a fresh mixer every time, summing weighted output
+    struct atomix_mixer* mix = atomixMixerNew(0.5f, 0);
+    atomixMixerPlay(mix, mus, ATOMIX_LOOP, 0.5f, -0.25f);
+    atomixMixerPlay(mix, snd, ATOMIX_LOOP, 1.0f, 0.5f);
+    float buff[2048]; double sum = 0.0;
+    for (int i = 0; i < 256; i++) {
+        atomixMixerMix(mix, buff, 1024);
+        for (int j = 0; j < 2048; j++) sum += buff[j]*(double)(j % 7 + 1);
+    }
+    free(mix);
+    return sum;
+}
+int bankTest (struct atomix_sound** snds) {
+    //bank just large enough for both sounds and their record headers
+    size_t size = sizeof(struct atmx_bankhead);
+    for (int i = 0; i < 2; i++) size += sizeof(struct atmx_bankrec) + atmxSoundBytes(snds[i]->cha, snds[i]->len, 0);
+    struct atomix_bank* bank = atomixBankCreate("/atomix_test", size);
+    if (!bank) { printf("Bank could not be created!\n"); return 1; }
+    printf("<<BANK BEGIN>>\n");
+    for (int i = 0; i < 2; i++) free(atomixBankAdd(bank, snds[i]->cha, (float*)snds[i]->data, snds[i]->len, 0));
+    double ref = bankChecksum(snds[0], snds[1]);
+    //child process attaches read-only and mixes the same scene from the shared data
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        struct atomix_bank* att = atomixBankAttach("/atomix_test");
+        struct atomix_sound* mus = att ? atomixBankSound(att, 0) : NULL;
+        struct atomix_sound* snd = att ? atomixBankSound(att, 1) : NULL;
+        int ok = mus && snd && (bankChecksum(mus, snd) == ref);
+        printf("Child: attached to %d sounds, output %s\n", att ? atomixBankCount(att) : 0, ok ? "identical" : "DIFFERENT");
+        free(mus); free(snd);
+        if (att) { atomixBankClose(att, 0); free(att); }
+        fflush(stdout); _exit(!ok);
+    }
+    int status = 1;
+    if (pid > 0) waitpid(pid, &status, 0);
+    //recreating the bank leaves a process still attached to the old one with all of its sounds
+    struct atomix_bank* old = atomixBankAttach("/atomix_test"), *fresh = atomixBankCreate("/atomix_test", size);
+    struct atomix_sound* kept = old ? atomixBankSound(old, 1) : NULL;
+    int recreate = fresh && kept && (atomixBankCount(old) == 2)&&(!memcmp(kept->data, snds[1]->data, snds[1]->len*snds[1]->cha*sizeof(float)));
+    printf("Recreate %s\n", recreate ? "OK" : "FAILED");
+    free(kept);
+    if (old) { atomixBankClose(old, 0); free(old); }
+    if (fresh) { atomixBankClose(fresh, 0); free(fresh); }
+    //a record claiming more data than the mapping holds is refused rather than read past the end
+    struct atomix_sound* first = atomixBankSound(bank, 0);
+    struct atmx_bankrec* rec = (struct atmx_bankrec*)(void*)(bank->base + sizeof(struct atmx_bankhead) + sizeof(struct atmx_bankrec) +
+        atmxSoundBytes(snds[0]->cha, snds[0]->len, 0));
+    rec->len = 0x10000000; struct atomix_sound* bad = atomixBankSound(bank, 1);
+    int corrupt = first && (!bad);
+    printf("Corrupt record %s\n", corrupt ? "refused" : "ACCEPTED");
+    free(first); free(bad);
+    printf("Bank: %.1f MB stored once instead of once per process\n", (double)size/1048576.0);
+    printf("<<BANK END>>\n");
+    atomixBankClose(bank, 1); free(bank);
+    return (pid < 0)||(!WIFEXITED(status))||WEXITSTATUS(status)||(!recreate)||(!corrupt);
+}
+#endif
+
+//comparative benchmark against mixing miniaudio decoders by hand
+struct cmp_voice {
+    ma_decoder dec; //raw decoder reading the sound data from memory
+    float gl, gr; //left and right gain
+    int32_t fade; //fade in progress
+};
+void compareMix (struct cmp_voice* vs, int num, float* out, float* tmp, uint32_t fnum, int32_t fmax) {
+    //mix every voice into the cleared output buffer
+    memset(out, 0, fnum*2*sizeof(float));
+    for (int v = 0; v < num; v++) {
+        //read enough frames, seeking back to the start whenever the end is reached
+        ma_uint64 got = 0;
+        while (got < fnum) {
+            ma_uint64 n = ma_decoder_read_pcm_frames(&vs[v].dec, tmp + got*2, fnum - got);
+            if (n == 0) ma_decoder_seek_to_pcm_frame(&vs[v].dec, 0);
+            got += n;
+        }
+        //apply fade and gain while accumulating
+        for (uint32_t i = 0; i < fnum; i++) {
+            float f = (vs[v].fade < fmax) ? (float)vs[v].fade++/(float)fmax : 1.0f;
+            out[i*2] += tmp[i*2]*vs[v].gl*f;
+            out[i*2+1] += tmp[i*2+1]*vs[v].gr*f;
+        }
+    }
+    //clip like atomix does
+    for (uint32_t i = 0; i < fnum*2; i++) out[i] = (out[i] < -1.0f) ? -1.0f : (out[i] > 1.0f) ? 1.0f : out[i];
+}
+void compareReport (uint64_t* lats, int num, double cps) {
+    //sort latencies and print throughput and distribution for 512 frame callbacks
+    uint64_t total = 0; for (int i = 0; i < num; i++) total += lats[i];
+    qsort(lats, num, sizeof(uint64_t), stressCompare);
+    printf(" %12.0f %8.2f %8.2f %8.2f", 512.0*num/(total/cps), lats[num/2]/cps*1e6, lats[num*99/100]/cps*1e6, lats[num - 1]/cps*1e6);
+}
+void benchCompare (struct atomix_sound* snd) {
+    //raw decoder configs for the sound data as stored by atomix, always output as stereo
+    ma_decoder_config icfg = ma_decoder_config_init(ma_format_f32, snd->cha, 48000);
+    ma_decoder_config ocfg = ma_decoder_config_init(ma_format_f32, 2, 48000);
+    struct cmp_voice* vs = malloc(256*sizeof(struct cmp_voice));
+    float out[1024], tmp[1024]; uint64_t lats[256];
+    uint64_t c0 = getCycles(); double t0 = getTime();
+    psleep(0.1);
+    double cps = (getCycles() - c0)/(getTime() - t0);
+    printf("<<COMPARE BEGIN>>\n");
+    printf("%6s %12s %8s %8s %8s %12s %8s %8s %8s\n", "voices", "atomix f/s", "p50 us", "p99 us", "max us",
+        "manual f/s", "p50 us", "p99 us", "max us");
+    for (int num = 16; num <= 256; num *= 4) {
+        //same scene for both, voices loop with random gain and pan and fade in over 4096 frames
+        struct atomix_mixer* mix = atomixMixerNew(0.5f, 4096);
+        for (int v = 0; v < num; v++) {
+            float gain = (float)rand()/(float)RAND_MAX, pan = 2.0f*(float)rand()/(float)RAND_MAX - 1.0f;
+            atomixMixerSetState(mix, atomixMixerPlay(mix, snd, ATOMIX_HALT, gain, pan), ATOMIX_LOOP);
+            ma_decoder_init_memory_raw(snd->data, snd->len*snd->cha*sizeof(float), &icfg, &ocfg, &vs[v].dec);
+            vs[v].gl = 0.5f*gain*(0.5f - pan/2.0f); vs[v].gr = 0.5f*gain*(0.5f + pan/2.0f); vs[v].fade = 0;
+        }
+        //time 256 callbacks of 512 frames each
+        printf("%6d", num);
+        for (int i = 0; i < 256; i++) {
+            uint64_t start = getCycles();
+            atomixMixerMix(mix, out, 512);
+            lats[i] = getCycles() - start;
+        }
+        compareReport(lats, 256, cps);
+        for (int i = 0; i < 256; i++) {
+            uint64_t start = getCycles();
+            compareMix(vs, num, out, tmp, 512, 4096);
+            lats[i] = getCycles() - start;
+        }
+        compareReport(lats, 256, cps);
+        printf("\n");
+        //clean up scene
+        for (int v = 0; v < num; v++) ma_decoder_uninit(&vs[v].dec);
+        free(mix);
+    }
+    printf("<<COMPARE END>>\n");
+    free(vs);
+}
+
 //main function
 int main (int argc, char *argv[]) {
     //perpare variables
     ma_device dev;
-    float bench_buff[1024];
-    void* fmus; void* fsnd;
-    ma_uint64 fmus_size, fsnd_size;
-    ma_decoder_config fmus_cfg, fsnd_cfg;
-    fmus_cfg = fsnd_cfg = ma_decoder_config_init(ma_format_f32, 0, 48000);
+    struct atomix_sound* mus = NULL; struct atomix_sound* snd = NULL;
     //initialize rand
     srand(getTime()*65536.0);
-    //check arguments
+    //check arguments, decoding audio straight into atomix sounds
     if (argc < 3) printf("Missing argument!\n");
-    else if (ma_decode_file(argv[1], &fmus_cfg, &fmus_size, &fmus) != MA_SUCCESS)
+    else if (!(mus = loadSound(argv[1])))
         printf("Music could not be loaded!\n");
-    else if (ma_decode_file(argv[2], &fsnd_cfg, &fsnd_size, &fsnd) != MA_SUCCESS)
+    else if (!(snd = loadSound(argv[2]))) {
         printf("Sound could not be loaded!\n");
+        free(mus);
+    }
     else {
-        //transfer audio data into atomix sounds and free temporary buffers
-        struct atomix_sound* mus; struct atomix_sound* snd;
-        mus = atomixSoundNew(fmus_cfg.channels, fmus, fmus_size);
-        snd = atomixSoundNew(fsnd_cfg.channels, fsnd, fsnd_size);
-        ma_free(fmus); ma_free(fsnd);
+        int record = 0;
+        #ifdef TEST_TRACE
+            trace_snds[0] = mus; trace_snds[1] = snd;
+            //replay trace instead of benchmark and demo if requested
+            if ((argc > 4)&&(!strcmp(argv[3], "replay"))) {
+                int ret = traceReplay(argv[4]);
+                if (ret) printf("Trace could not be loaded!\n");
+                free(mus); free(snd);
+                return ret;
+            }
+            //start recording trace if requested
+            record = (argc > 4)&&(!strcmp(argv[3], "record"));
+            if (record) {
+                trace_buff = malloc(TRACE_MAX*sizeof(struct trace_rec));
+                trace_start = getTime();
+            }
+        #endif
+        //benchmark kernels in isolation instead of benchmark and demo if requested
+        if ((argc > 3)&&(!strcmp(argv[3], "kernels"))) {
+            benchKernels();
+            free(mus); free(snd);
+            return 0;
+        }
+        //check real-time safety of the mixing thread instead of benchmark and demo if requested
+        #if defined(TEST_RTCHECK)&&defined(__GLIBC__)
+            if ((argc > 3)&&(!strcmp(argv[3], "rtcheck"))) {
+                struct atomix_sound* snds[2] = {mus, snd};
+                int ret = rtCheck(snds);
+                free(mus); free(snd);
+                return ret;
+            }
+        #endif
+        //run contention stress test instead of benchmark and demo if requested
+        if ((argc > 3)&&(!strcmp(argv[3], "stress"))) {
+            struct atomix_sound* snds[2] = {mus, snd};
+            int ret = stressTest(snds);
+            free(mus); free(snd);
+            return ret;
+        }
+        //degrade under a time budget instead of benchmark and demo if requested
+        if ((argc > 3)&&(!strcmp(argv[3], "budget"))) {
+            struct atomix_sound* snds[2] = {mus, snd};
+            int ret = budgetTest(snds);
+            free(mus); free(snd);
+            return ret;
+        }
+        //estimate mix cost instead of benchmark and demo if requested
+        if ((argc > 3)&&(!strcmp(argv[3], "estimate"))) {
+            struct atomix_sound* snds[2] = {mus, snd};
+            int ret = estimateTest(snds);
+            free(mus); free(snd);
+            return ret;
+        }
+        //loop again after a release instead of benchmark and demo if requested
+        if ((argc > 3)&&(!strcmp(argv[3], "loops"))) {
+            struct atomix_sound* snds[2] = {mus, snd};
+            int ret = loopTest(snds);
+            free(mus); free(snd);
+            return ret;
+        }
+        //ramp playback rates instead of benchmark and demo if requested
+        if ((argc > 3)&&(!strcmp(argv[3], "pitch"))) {
+            struct atomix_sound* snds[2] = {mus, snd};
+            int ret = pitchTest(snds);
+            free(mus); free(snd);
+            return ret;
+        }
+        //share sounds through a registry instead of benchmark and demo if requested
+        if ((argc > 3)&&(!strcmp(argv[3], "dedup"))) {
+            struct atomix_sound* snds[2] = {mus, snd};
+            int ret = dedupTest(snds);
+            free(mus); free(snd);
+            return ret;
+        }
+        //resample sounds instead of benchmark and demo if requested
+        if ((argc > 3)&&(!strcmp(argv[3], "resample"))) {
+            int ret = resampleTest();
+            free(mus); free(snd);
+            return ret;
+        }
+        //create sounds from integer samples instead of benchmark and demo if requested
+        if ((argc > 3)&&(!strcmp(argv[3], "formats"))) {
+            int ret = formatTest(mus);
+            free(mus); free(snd);
+            return ret;
+        }
+        //share sounds with a second process instead of benchmark and demo if requested
+        #if defined(ATOMIX_SHM)&&!defined(WIN32)
+            if ((argc > 3)&&(!strcmp(argv[3], "bank"))) {
+                struct atomix_sound* snds[2] = {mus, snd};
+                int ret = bankTest(snds);
+                free(mus); free(snd);
+                return ret;
+            }
+        #endif
+        //lock memory and mix at real-time priority instead of benchmark and demo if requested
+        #if defined(ATOMIX_MLOCK)&&!defined(WIN32)
+            if ((argc > 3)&&(!strcmp(argv[3], "mlock"))) {
+                struct atomix_sound* snds[2] = {mus, snd};
+                int ret = mlockTest(snds);
+                atomixSoundFree(mus); atomixSoundFree(snd);
+                return ret;
+            }
+        #endif
+        //compare against miniaudio instead of benchmark and demo if requested
+        if ((argc > 3)&&(!strcmp(argv[3], "compare"))) {
+            benchCompare(mus);
+            free(mus); free(snd);
+            return 0;
+        }
         //create atomix mixer with volume of 0.5
         struct atomix_mixer* mix = atomixMixerNew(0.5f, 0);
-        //begin benchmarking
-        printf("<<BENCHMARK BEGIN>>\n");
-        //mix 512 at a time 512 times with 256 sounds
-        for (int i = 0; i < 256; i++) atomixMixerPlay(mix, mus, ATOMIX_LOOP, 1.0f, 0.0f);
-        double start = getTime();
-        for (int i = 0; i < 512; i++) atomixMixerMix(mix, bench_buff, 512);
-        double end = getTime();
-        atomixMixerStopAll(mix); //mark all layers for clearing
-        atomixMixerMix(mix, bench_buff, 512); //make sure layers are actually cleared
-        printf("256: %.0ff/s <- %.0ff/s (%.3fMiB/s)\n", 262144.0/(end-start), 16777216.0/(end-start), 2.0/(end-start));
-        //mix 512 at a time 512 times with single sound
-        atomixMixerPlay(mix, mus, ATOMIX_LOOP, 1.0f, 0.0f);
-        start = getTime();
-        for (int i = 0; i < 512; i++) atomixMixerMix(mix, bench_buff, 512);
-        end = getTime();
-        atomixMixerStopAll(mix); //mark all layers for clearing
-        atomixMixerMix(mix, bench_buff, 512); //make sure layers are actually cleared
-        printf("One: %.0ff/s <- %.0ff/s (%.3fMiB/s)\n", 262144.0/(end-start), 262144.0/(end-start), 2.0/(end-start));
-        //benchmarking done
-        printf("<<BENCHMARK END>>\n");
+        //open performance counters if requested
+        if ((argc > 3)&&(!strcmp(argv[3], "perf"))) {
+            perf_on = !perfOpen();
+            if (!perf_on) printf("Performance counters unavailable!\n");
+        }
+        //benchmark mixer unless recording
+        if (!record) benchmark(mix, mus);
         //create miniaudio playback device
         ma_device_config cfg = ma_device_config_init(ma_device_type_playback);
         cfg.playback.pDeviceID = NULL;
@@ -142,8 +1342,15 @@ int main (int argc, char *argv[]) {
         psleep(0.25);
         //uninit playback device
         ma_device_uninit(&dev);
+        //write out trace if recording
+        #ifdef TEST_TRACE
+            if (record) {
+                if (traceWrite(argv[4])) printf("Trace could not be written!\n");
+                free(trace_buff);
+            }
+        #endif
         //free mixer and sounds
-        free(mix); free(mus); free(snd);
+        atomixMixerFree(mix); atomixSoundFree(mus); atomixSoundFree(snd);
     }
     //return
     return 0;